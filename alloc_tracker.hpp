@@ -0,0 +1,244 @@
+///////////////////////////////////////////////////////////////////////////////
+// alloc_tracker.hpp
+//
+// Opt-in heap allocation accounting.
+//
+// To turn it on, define GNOMES_TRACK_ALLOCATIONS before including this file,
+// in exactly one source file of the program. That source file then replaces
+// the global operator new and operator delete with versions that count the
+// number of allocations, the bytes allocated, and the peak number of bytes
+// live at once. Without the macro, this file only declares AllocationScope,
+// which then always reports zero, and RssScope.
+//
+// How to use:
+//
+//    AllocationScope scope;
+//    // run the code you want measured
+//    cout << scope.allocations() << " allocations, "
+//         << scope.bytes() << " bytes, "
+//         << scope.peak_bytes() << " bytes peak" << endl;
+//
+// Scopes should not be nested or overlap across threads, since each scope
+// restarts the shared peak counter. The same holds for RssScope, which
+// measures how much the process's resident set grows, heap or not.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <new>
+#include <string>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+// Process-wide allocation counters, updated by the replacement operator new
+// and operator delete.
+struct AllocationCounters {
+  std::atomic<unsigned long long> allocations, bytes, live, peak;
+
+  static AllocationCounters& global() {
+    static AllocationCounters counters;
+    return counters;
+  }
+
+  // Raise peak to at least value.
+  void raise_peak(unsigned long long value) {
+    auto seen = peak.load(std::memory_order_relaxed);
+    while (seen < value &&
+           !peak.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {
+    }
+  }
+};
+
+// Return true if this program was built with GNOMES_TRACK_ALLOCATIONS.
+bool is_allocation_tracking_enabled() {
+#ifdef GNOMES_TRACK_ALLOCATIONS
+  return true;
+#else
+  return false;
+#endif
+}
+
+// Measures heap allocations made between its creation, or the last reset, and
+// each query.
+class AllocationScope {
+private:
+  unsigned long long _allocations, _bytes, _live;
+
+public:
+
+  // Start measuring as soon as the scope is created.
+  AllocationScope() {
+    reset();
+  }
+
+  // Restart the measurement.
+  void reset() {
+    auto& counters = AllocationCounters::global();
+    _allocations = counters.allocations.load();
+    _bytes = counters.bytes.load();
+    _live = counters.live.load();
+    counters.peak.store(_live);
+  }
+
+  // Number of allocations made.
+  unsigned long long allocations() const {
+    return AllocationCounters::global().allocations.load() - _allocations;
+  }
+
+  // Total bytes requested by those allocations.
+  unsigned long long bytes() const {
+    return AllocationCounters::global().bytes.load() - _bytes;
+  }
+
+  // Most bytes live at once, beyond what was live when measuring started.
+  unsigned long long peak_bytes() const {
+    auto peak = AllocationCounters::global().peak.load();
+    return (peak > _live) ? (peak - _live) : 0;
+  }
+};
+
+// Return the given field of /proc/self/status, such as "VmRSS", in
+// kilobytes, or -1 if it cannot be read.
+long proc_status_kilobytes(const char* field) {
+  std::ifstream status("/proc/self/status");
+  const size_t length = std::strlen(field);
+  std::string line;
+  while (std::getline(status, line)) {
+    if (line.compare(0, length, field) == 0 &&
+        line.size() > length && line[length] == ':') {
+      return std::atol(line.c_str() + length + 1);
+    }
+  }
+  return -1;
+}
+
+// Measures how far the resident set size of this process rises above its
+// size when the scope was created or last reset.
+//
+// getrusage's ru_maxrss is a high-water mark over the whole life of the
+// process, so it cannot tell one solver's peak from an earlier one's. reset
+// instead hands freed heap memory back to the system where the C library
+// allows it, restarts the kernel's high-water mark by writing 5 to
+// /proc/self/clear_refs, and records the current size. That needs Linux;
+// elsewhere is_supported is false and the growth is reported as -1.
+class RssScope {
+private:
+  long _start;
+  bool _supported;
+
+public:
+
+  // Start measuring as soon as the scope is created.
+  RssScope() {
+    reset();
+  }
+
+  // Restart the measurement.
+  void reset() {
+#ifdef __GLIBC__
+    malloc_trim(0);
+#endif
+    std::ofstream clear_refs("/proc/self/clear_refs");
+    clear_refs << "5" << std::flush;
+    _start = proc_status_kilobytes("VmRSS");
+    _supported = clear_refs.good() && _start >= 0;
+  }
+
+  bool is_supported() const { return _supported; }
+
+  // Most kilobytes resident at once, beyond the size when measuring started.
+  long peak_growth_kilobytes() const {
+    if (!_supported) {
+      return -1;
+    }
+    long peak = proc_status_kilobytes("VmHWM");
+    return (peak > _start) ? (peak - _start) : 0;
+  }
+};
+
+#ifdef GNOMES_TRACK_ALLOCATIONS
+
+// Every block is preceded by a header recording its size; the header is
+// sized to keep the block aligned for any fundamental type.
+const size_t ALLOCATION_HEADER_BYTES = alignof(std::max_align_t);
+
+void* tracked_allocate(size_t size) {
+  void* base = std::malloc(size + ALLOCATION_HEADER_BYTES);
+  if (!base) {
+    return nullptr;
+  }
+  *static_cast<size_t*>(base) = size;
+
+  auto& counters = AllocationCounters::global();
+  counters.allocations.fetch_add(1, std::memory_order_relaxed);
+  counters.bytes.fetch_add(size, std::memory_order_relaxed);
+  counters.raise_peak(counters.live.fetch_add(size, std::memory_order_relaxed) + size);
+  return static_cast<char*>(base) + ALLOCATION_HEADER_BYTES;
+}
+
+// Kept out of line: once inlined into a caller's operator delete, GCC sees the
+// header arithmetic applied to what it believes is the start of an array and
+// reports -Warray-bounds at -O2.
+__attribute__((noinline)) void tracked_free(void* p) {
+  if (!p) {
+    return;
+  }
+  void* base = static_cast<char*>(p) - ALLOCATION_HEADER_BYTES;
+  AllocationCounters::global().live.fetch_sub(*static_cast<size_t*>(base),
+                                              std::memory_order_relaxed);
+  std::free(base);
+}
+
+void* operator new(size_t size) {
+  void* p = tracked_allocate(size);
+  if (!p) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+  return tracked_allocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+  return tracked_allocate(size);
+}
+
+void operator delete(void* p) noexcept {
+  tracked_free(p);
+}
+
+void operator delete[](void* p) noexcept {
+  tracked_free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept {
+  tracked_free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept {
+  tracked_free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+  tracked_free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+  tracked_free(p);
+}
+
+#endif
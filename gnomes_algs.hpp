@@ -12,125 +12,866 @@
 
 #pragma once
 
+#include <algorithm>
 #include <cassert>
-#include <math.h>
+#include <limits>
+#include <memory>
 #include <vector>
+#include "gnomes_stats.hpp"
 #include "gnomes_types.hpp"
 
 namespace gnomes {
 
+// Depth-first helper for greedy_gnomes_exhaustive. Considers candidate and
+// every extension of it, replacing best with any strictly better path, then
+// restores candidate to how it was on entry. Moves down are explored before
+// moves right, and a branch ends as soon as a step would leave the grid or
+// hit a rock.
+template <typename Stats>
+void exhaustive_search(path& candidate, path& best, Stats& stats) {
+  stats.count_candidate();
+  if (candidate.total_gold() > best.total_gold()) {
+    best = candidate;
+    stats.count_path_copy();
+  }
+
+  for (auto dir : {STEP_DIRECTION_DOWN, STEP_DIRECTION_RIGHT}) {
+    if (candidate.is_step_valid(dir)) {
+      candidate.add_step(dir);
+      exhaustive_search(candidate, best, stats);
+      candidate.pop_step();
+    }
+  }
+}
+
+void exhaustive_search(path& candidate, path& best) {
+  no_stats stats;
+  exhaustive_search(candidate, best, stats);
+}
+
 // Solve the greedy gnomes problem for the given grid, using an exhaustive
 // search algorithm.
 //
-// This algorithm is expected to run in exponential time, so the grid's
-// width+height must be small enough to fit in a 64-bit int; this is enforced
-// with an assertion.
+// Every distinct valid path is visited exactly once, by extending a single
+// path in place and undoing its last step on the way back. Among equally good
+// paths, the first one visited in depth-first order, with moves down before
+// moves right, wins. That is always a path that ends on the last gold cell it
+// collects, or the path of no steps when there is no gold to collect.
+//
+// Earlier versions enumerated bit patterns by length and could return, on a
+// tie, a path with extra steps past its last gold cell; the gold is the same,
+// but the path may differ from theirs.
+//
+// This algorithm is expected to run in exponential time, so it is only
+// practical for small grids; paths are packed bits of any length, so there is
+// no fixed limit on the grid's width+height.
+//
+// The search is reported to stats, a statistics policy from gnomes_stats.hpp.
+// When arena is not null, the paths are stored in it, and so is the returned
+// path.
 //
 // The grid must be non-empty.
-  path greedy_gnomes_exhaustive(const grid& setting) {
+  template <typename Stats>
+  path greedy_gnomes_exhaustive(const grid& setting, Stats& stats,
+                                path_arena* arena = nullptr) {
 
   // grid must be non-empty.
     assert(setting.rows() > 0);
     assert(setting.columns() > 0);
 
-  // Compute maximum path length, and check that it is legal.
-    const size_t max_steps = setting.rows() + setting.columns() - 1;
-    assert(max_steps < 64);
-
-    path best(setting);
-    for(int len=1;len<max_steps;len++){
-      for(int bits=0;bits<pow(2,len)-1;bits++){
-        path candidate(setting);
-        for(int k=0;k<len;k++){
-          auto bit = (bits>>k)&1;
-          if(bit==1){
-            if(candidate.is_step_valid(STEP_DIRECTION_RIGHT))
-              candidate.add_step(STEP_DIRECTION_RIGHT);
-          }else
-          if(candidate.is_step_valid(STEP_DIRECTION_DOWN))
-            candidate.add_step(STEP_DIRECTION_DOWN);
-        }
-        if (candidate.total_gold()>best.total_gold())
-          best = candidate;
+    stats.begin_phase(PHASE_INIT);
+    path best(setting, arena), candidate(setting, arena);
+    stats.count_path_copy();
+    stats.count_path_copy();
+    stats.end_phase(PHASE_INIT);
+
+    stats.begin_phase(PHASE_FILL);
+    exhaustive_search(candidate, best, stats);
+    stats.end_phase(PHASE_FILL);
+    return best;
+  }
+
+  path greedy_gnomes_exhaustive(const grid& setting, path_arena* arena = nullptr) {
+    no_stats stats;
+    return greedy_gnomes_exhaustive(setting, stats, arena);
+  }
+
+// First-half helper for greedy_gnomes_exhaustive_meet_in_middle. Enumerates
+// every extension of candidate by at most moves_left more moves. Paths that
+// stop short compete for best; paths that use all the moves end on the middle
+// anti-diagonal, and the best one ending in each row of it is kept in
+// best_crossing, indexed by row, with found marking the rows that have one.
+void exhaustive_search_first_half(path& candidate, size_t moves_left,
+                                  path& best,
+                                  std::vector<path>& best_crossing,
+                                  std::vector<bool>& found) {
+  if (moves_left == 0) {
+    auto row = candidate.final_row();
+    if (!found[row] ||
+        candidate.total_gold() > best_crossing[row].total_gold()) {
+      best_crossing[row] = candidate;
+      found[row] = true;
+    }
+    return;
+  }
+
+  if (candidate.total_gold() > best.total_gold()) {
+    best = candidate;
+  }
+
+  for (auto dir : {STEP_DIRECTION_DOWN, STEP_DIRECTION_RIGHT}) {
+    if (candidate.is_step_valid(dir)) {
+      candidate.add_step(dir);
+      exhaustive_search_first_half(candidate, moves_left - 1, best,
+                                   best_crossing, found);
+      candidate.pop_step();
+    }
+  }
+}
+
+// Solve the greedy gnomes problem for the given grid, using an exhaustive
+// search that meets in the middle.
+//
+// Every path long enough to reach the anti-diagonal row+column = d, where d is
+// half the longest path length, crosses it in exactly one cell, and the gold
+// collected after that cell does not depend on how the path got there. So
+// this enumerates all first halves up to the diagonal, keeps only the best
+// one into each diagonal cell, and then enumerates all second halves starting
+// from those. That costs about 2^d paths for the first half plus 2^d for each
+// diagonal cell, instead of about 2^(2d). Paths are held as packed bits, so
+// there is no limit on the grid's width+height beyond time and memory.
+//
+// The gold collected always matches greedy_gnomes_exhaustive, but when several
+// paths tie the two may return different ones.
+//
+// When arena is not null, the paths are stored in it, and so is the returned
+// path.
+//
+// The grid must be non-empty.
+path greedy_gnomes_exhaustive_meet_in_middle(const grid& setting,
+                                             path_arena* arena = nullptr) {
+  assert(setting.rows() > 0);
+  assert(setting.columns() > 0);
+
+  const size_t middle = (setting.rows() + setting.columns() - 2) / 2;
+
+  path best(setting, arena), candidate(setting, arena);
+  std::vector<path> best_crossing(setting.rows(), candidate);
+  std::vector<bool> found(setting.rows(), false);
+  exhaustive_search_first_half(candidate, middle, best, best_crossing, found);
+
+  for (coordinate row = 0; row < setting.rows(); ++row) {
+    if (found[row]) {
+      exhaustive_search(best_crossing[row], best);
+    }
+  }
+
+  return best;
+}
+
+// Return the cells of word that can be reached by starting in a cell of
+// seeds and moving right through cells of open, including the seeds
+// themselves. Column k of the word is bit k, so moving right is a left shift.
+// This is a Kogge-Stone occluded fill: each round doubles the distance a seed
+// has spread, so a whole word takes six shift/AND/OR rounds.
+row_word fill_right(row_word seeds, row_word open) {
+  seeds &= open;
+  seeds |= open & (seeds << 1);
+  open &= open << 1;
+  seeds |= open & (seeds << 2);
+  open &= open << 2;
+  seeds |= open & (seeds << 4);
+  open &= open << 4;
+  seeds |= open & (seeds << 8);
+  open &= open << 8;
+  seeds |= open & (seeds << 16);
+  open &= open << 16;
+  seeds |= open & (seeds << 32);
+  return seeds;
+}
+
+// Return a bitboard, laid out like the grid's own, marking every cell that
+// some valid path reaches from (0, 0).
+//
+// Each row is computed from the one above, a word at a time: the reachable
+// cells above that are not rocks seed the row, and fill_right spreads them
+// rightwards through open cells, carrying into the next word. Once a row has
+// no reachable cell, neither has any row below it.
+std::vector<row_word> reachable_cells(const grid& setting) {
+  const coordinate r = setting.rows(),
+                   words = setting.words_per_row(),
+                   tail = setting.columns() % CELLS_PER_WORD;
+  const row_word last_word_mask = tail ? ((row_word(1) << tail) - 1) : ~row_word(0);
+
+  std::vector<row_word> reach(r * words, 0);
+  for (coordinate i = 0; i < r; ++i) {
+    const row_word* rock = setting.rock_row(i);
+    row_word carry = 0, any = 0;
+    for (coordinate w = 0; w < words; ++w) {
+      row_word open = ~rock[w] & ((w + 1 == words) ? last_word_mask : ~row_word(0)),
+               seeds = (i > 0) ? reach[(i - 1) * words + w] : ((w == 0) ? 1 : 0);
+      row_word cells = fill_right(seeds | carry, open);
+      reach[i * words + w] = cells;
+      carry = cells >> (CELLS_PER_WORD - 1);
+      any |= cells;
+    }
+    if (!any) {
+      break;
+    }
+  }
+  return reach;
+}
+
+// The columns first through last of one row. A span with first > last is
+// empty.
+struct column_span {
+  coordinate first, last;
+
+  bool is_empty() const { return first > last; }
+};
+
+// Return true if the given grid has no rock cells.
+bool is_rock_free(const grid& setting) {
+  const row_word* rock = setting.rock_row(0);
+  for (size_t w = 0; w < setting.rows() * setting.words_per_row(); ++w) {
+    if (rock[w]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Find, for each row, the narrowest span holding every cell of that row that
+// a valid path reaches from (0, 0), as reachable_cells would mark them, and
+// store them in spans. Cells outside the spans can be skipped by any solver.
+//
+// Rows are computed as in reachable_cells, but only one row of reachable
+// cells is kept, in reach, and each row is reduced to its span as soon as it
+// is known. Both vectors keep their storage between calls, so a caller that
+// solves many grids allocates them only once.
+void find_reachable_spans(const grid& setting, std::vector<row_word>& reach,
+                          std::vector<column_span>& spans) {
+  const coordinate r = setting.rows(),
+                   words = setting.words_per_row(),
+                   tail = setting.columns() % CELLS_PER_WORD;
+  const row_word last_word_mask = tail ? ((row_word(1) << tail) - 1) : ~row_word(0);
+
+  // Before row 0, reach holds just the seed (0, 0).
+  reach.assign(words, 0);
+  reach[0] = 1;
+  spans.assign(r, column_span{ 1, 0 });
+  for (coordinate i = 0; i < r; ++i) {
+    const row_word* rock = setting.rock_row(i);
+    row_word carry = 0;
+    coordinate first_word = words, last_word = 0;
+    for (coordinate w = 0; w < words; ++w) {
+      row_word open = ~rock[w] & ((w + 1 == words) ? last_word_mask : ~row_word(0));
+      row_word cells = fill_right(reach[w] | carry, open);
+      reach[w] = cells;
+      carry = cells >> (CELLS_PER_WORD - 1);
+      if (cells) {
+        first_word = std::min(first_word, w);
+        last_word = w;
       }
     }
+    if (first_word == words) {
+      break;
+    }
+    spans[i].first = first_word * CELLS_PER_WORD + __builtin_ctzll(reach[first_word]);
+    spans[i].last = last_word * CELLS_PER_WORD + (CELLS_PER_WORD - 1) -
+                    __builtin_clzll(reach[last_word]);
+  }
+}
+
+// Return, for each row, the narrowest span holding every cell of that row
+// that a valid path reaches from (0, 0), as find_reachable_spans does.
+std::vector<column_span> reachable_spans(const grid& setting) {
+  std::vector<row_word> reach;
+  std::vector<column_span> spans;
+  find_reachable_spans(setting, reach, spans);
+  return spans;
+}
+
+// Return, for every cell in row-major order, an upper bound on the gold that
+// a path standing in that cell may still collect: the number of reachable
+// gold cells in the rectangle below and to the right of it (excluding the
+// cell itself), capped by the number of steps left before reaching the
+// bottom-right corner.
+std::vector<unsigned> remaining_gold_bounds(const grid& setting) {
+  const coordinate r = setting.rows(),
+                   c = setting.columns();
+  const auto reach = reachable_cells(setting);
+
+  // suffix[(i * (c + 1)) + j] counts gold in rows >= i and columns >= j.
+  std::vector<unsigned> suffix((r + 1) * (c + 1), 0);
+  std::vector<unsigned> bounds(r * c);
+  for (coordinate i = r; i > 0; --i) {
+    for (coordinate j = c; j > 0; --j) {
+      const coordinate column = j - 1;
+      unsigned here = (setting.get(i - 1, column) == CELL_GOLD &&
+                       ((reach[(i - 1) * setting.words_per_row() + column / CELLS_PER_WORD] >>
+                         (column % CELLS_PER_WORD)) & 1)) ? 1 : 0;
+      unsigned below = suffix[i * (c + 1) + (j - 1)],
+               right = suffix[(i - 1) * (c + 1) + j],
+               both = suffix[i * (c + 1) + j];
+      suffix[(i - 1) * (c + 1) + (j - 1)] = here + below + right - both;
+
+      unsigned steps_left = (r - i) + (c - j);
+      bounds[(i - 1) * c + (j - 1)] =
+        std::min(below + right - both, steps_left);
+    }
+  }
+  return bounds;
+}
+
+// Depth-first helper for greedy_gnomes_exhaustive_bounded. Works like
+// exhaustive_search, except that candidate is not extended when its gold plus
+// the bound for its final cell cannot beat best.
+template <typename Stats>
+void bounded_search(path& candidate, path& best,
+                    const std::vector<unsigned>& bounds,
+                    Stats& stats) {
+  stats.count_candidate();
+  if (candidate.total_gold() > best.total_gold()) {
+    best = candidate;
+    stats.count_path_copy();
+  }
+
+  auto bound = bounds[candidate.final_row() * candidate.setting().columns() +
+                      candidate.final_column()];
+  if (candidate.total_gold() + bound <= best.total_gold()) {
+    stats.count_pruned();
+    return;
+  }
+
+  for (auto dir : {STEP_DIRECTION_DOWN, STEP_DIRECTION_RIGHT}) {
+    if (candidate.is_step_valid(dir)) {
+      candidate.add_step(dir);
+      bounded_search(candidate, best, bounds, stats);
+      candidate.pop_step();
+    }
+  }
+}
+
+// Solve the greedy gnomes problem for the given grid, using an exhaustive
+// search with branch and bound.
+//
+// This returns exactly the same path as greedy_gnomes_exhaustive, since a
+// pruned branch can at best tie the path already found, which the plain search
+// would not take either. The search is reported to stats; with a solver_stats,
+// candidates_evaluated counts the partial paths visited and branches_pruned
+// those whose extensions were skipped. When arena is not null, the paths are
+// stored in it, and so is the returned path.
+//
+// The grid must be non-empty.
+template <typename Stats>
+path greedy_gnomes_exhaustive_bounded(const grid& setting, Stats& stats,
+                                      path_arena* arena = nullptr) {
+  assert(setting.rows() > 0);
+  assert(setting.columns() > 0);
+
+  stats.begin_phase(PHASE_INIT);
+  auto bounds = remaining_gold_bounds(setting);
+  path best(setting, arena), candidate(setting, arena);
+  stats.count_path_copy();
+  stats.count_path_copy();
+  stats.end_phase(PHASE_INIT);
+
+  stats.begin_phase(PHASE_FILL);
+  bounded_search(candidate, best, bounds, stats);
+  stats.end_phase(PHASE_FILL);
+  return best;
+}
+
+path greedy_gnomes_exhaustive_bounded(const grid& setting,
+                                      path_arena* arena = nullptr) {
+  no_stats stats;
+  return greedy_gnomes_exhaustive_bounded(setting, stats, arena);
+}
+
+// Gold value stored in a dynamic programming table for a cell that no valid
+// path can reach from (0, 0).
+const unsigned UNREACHABLE = std::numeric_limits<unsigned>::max();
+
+// Dynamic programming table for the greedy gnomes problem.
+//
+// Each cell stores only the most gold that any path ending in that cell can
+// collect, plus a single bit recording whether that best path arrived from
+// the left (true) or from above (false). Both live in flat, row-major arrays,
+// so filling the table takes O(rows*columns) time and a few bytes per cell,
+// and the one path we actually want is rebuilt afterwards by following the
+// predecessor bits back to (0, 0).
+class dyn_prog_table {
+private:
+  coordinate rows_, columns_;
+  std::vector<unsigned> gold_;
+  std::vector<bool> from_left_;
+  std::vector<column_span> spans_;
+  // Scratch row for find_reachable_spans, kept so refills do not reallocate.
+  std::vector<row_word> reach_;
+
+  size_t index(coordinate row, coordinate column) const {
+    assert(row < rows_);
+    assert(column < columns_);
+    return row * columns_ + column;
+  }
+
+public:
+
+  // Create an empty table; call fill before querying it.
+  dyn_prog_table()
+  : rows_(0), columns_(0) { }
+
+  // Accessors.
+  coordinate rows() const { return rows_; }
+  coordinate columns() const { return columns_; }
+
+  // Return the most gold collectable by a path ending at the given cell, or
+  // UNREACHABLE.
+  unsigned gold(coordinate row, coordinate column) const {
+    return gold_[index(row, column)];
+  }
+
+  // Return true when some valid path ends at the given cell.
+  bool is_reachable(coordinate row, coordinate column) const {
+    return gold(row, column) != UNREACHABLE;
+  }
+
+  // Return the columns of the given row that the last fill computed; every
+  // reachable cell of the row was inside them at that time.
+  column_span span(coordinate row) const {
+    assert(row < rows_);
+    return spans_[row];
+  }
+
+  // Return true when the best path to the given reachable cell takes its last
+  // step to the right, false when it steps down. Meaningless for (0, 0).
+  bool is_from_left(coordinate row, coordinate column) const {
+    return from_left_[index(row, column)];
+  }
+
+  // Recompute the given cell of the table for the given grid, assuming the
+  // cells above and to the left of it are up to date. Return true if the
+  // cell's gold changed, which is when the cells after it may need
+  // recomputing too.
+  //
+  // When both neighbors tie, the path from above is preferred.
+  bool relax(const grid& setting, coordinate row, coordinate column) {
+    auto cell = setting.get(row, column);
+    unsigned best = UNREACHABLE;
+    bool from_left = false;
+    if (cell != CELL_ROCK) {
+      unsigned above = (row > 0) ? gold_[index(row - 1, column)] : UNREACHABLE,
+               left = (column > 0) ? gold_[index(row, column - 1)] : UNREACHABLE;
+      if (row == 0 && column == 0) {
+        best = 0;
+      } else if (above != UNREACHABLE &&
+                 (left == UNREACHABLE || above >= left)) {
+        best = above;
+      } else if (left != UNREACHABLE) {
+        best = left;
+        from_left = true;
+      }
+      if (best != UNREACHABLE && cell == CELL_GOLD) {
+        ++best;
+      }
+    }
+
+    size_t k = index(row, column);
+    from_left_[k] = from_left;
+    bool changed = (gold_[k] != best);
+    gold_[k] = best;
+    return changed;
+  }
+
+  // Fill the table for the given grid, reporting to stats. Storage is
+  // reused when the table is refilled, so one table may serve many grids.
+  //
+  // When prune_unreachable is true and the grid has rocks, a
+  // find_reachable_spans pre-pass first finds the span of each row that paths
+  // can reach, and only cells inside the spans are computed; the rest stay
+  // UNREACHABLE. Otherwise, including every grid without rocks, where all
+  // cells are reachable and the pre-pass could not pay for itself, every cell
+  // is computed.
+  template <typename Stats>
+  void fill(const grid& setting, Stats& stats, bool prune_unreachable = true) {
+    stats.begin_phase(PHASE_INIT);
+    rows_ = setting.rows();
+    columns_ = setting.columns();
+    gold_.assign(rows_ * columns_, UNREACHABLE);
+    from_left_.assign(rows_ * columns_, false);
+    if (prune_unreachable && !is_rock_free(setting)) {
+      find_reachable_spans(setting, reach_, spans_);
+    } else {
+      spans_.assign(rows_, column_span{ 0, columns_ - 1 });
+    }
+    stats.end_phase(PHASE_INIT);
+
+    stats.begin_phase(PHASE_FILL);
+    for (coordinate i = 0; i < rows_; ++i) {
+      for (coordinate j = spans_[i].first; j <= spans_[i].last; ++j) {
+        stats.count_cell_relaxed();
+        relax(setting, i, j);
+      }
+    }
+    stats.end_phase(PHASE_FILL);
+  }
+
+  void fill(const grid& setting, bool prune_unreachable = true) {
+    no_stats stats;
+    fill(setting, stats, prune_unreachable);
+  }
+
+  // Rebuild the best path ending at the given reachable cell by walking the
+  // predecessor bits back to (0, 0), in time proportional to its length and
+  // without reading the grid. The path is stored in arena, or on the heap if
+  // it is null.
+  path backtrack(const grid& setting, coordinate row, coordinate column,
+                 path_arena* arena = nullptr) const {
+    assert(setting.rows() == rows_);
+    assert(setting.columns() == columns_);
+    assert(is_reachable(row, column));
+
+    return path(setting, row, column, gold(row, column),
+                [this](coordinate i, coordinate j) { return is_from_left(i, j); },
+                arena);
+  }
+};
+
+// Solve the greedy gnomes problem for the given grid, using a dynamic
+// programming algorithm and the given table as scratch space. Reusing one
+// table across many calls avoids reallocating it for every grid.
+//
+// Runs in O(rows*columns) time. Among equally good paths, this returns the
+// one ending at the first such cell in row-major order.
+//
+// The solve is reported to stats, a statistics policy from gnomes_stats.hpp.
+// When arena is not null, the returned path is stored in it.
+//
+// The grid must be non-empty.
+  template <typename Stats>
+  path greedy_gnomes_dyn_prog(const grid& setting, dyn_prog_table& table,
+                              Stats& stats, path_arena* arena = nullptr) {
+
+  // grid must be non-empty.
+    assert(setting.rows() > 0);
+    assert(setting.columns() > 0);
+
+    table.fill(setting, stats);
+
+    //post processing to find the cell ending the max gold path
+    stats.begin_phase(PHASE_POST);
+    coordinate best_row = 0, best_column = 0;
+    for (coordinate i = 0; i < table.rows(); i++)
+      for (coordinate j = table.span(i).first; j <= table.span(i).last; j++)
+        if (table.is_reachable(i, j) &&
+            table.gold(i, j) > table.gold(best_row, best_column)) {
+          best_row = i;
+          best_column = j;
+        }
+
+    auto best = table.backtrack(setting, best_row, best_column, arena);
+    stats.count_path_copy();
+    stats.end_phase(PHASE_POST);
     return best;
   }
 
+  path greedy_gnomes_dyn_prog(const grid& setting, dyn_prog_table& table,
+                              path_arena* arena = nullptr) {
+    no_stats stats;
+    return greedy_gnomes_dyn_prog(setting, table, stats, arena);
+  }
+
 // Solve the greedy gnomes problem for the given grid, using a dynamic
 // programming algorithm.
 //
 // The grid must be non-empty.
-  path greedy_gnomes_dyn_prog(const grid& setting) {
-    const size_t r = setting.rows();
-    const size_t c = setting.columns();
+  template <typename Stats>
+  path greedy_gnomes_dyn_prog(const grid& setting, Stats& stats,
+                              path_arena* arena = nullptr) {
+    dyn_prog_table table;
+    return greedy_gnomes_dyn_prog(setting, table, stats, arena);
+  }
 
-  // grid must be non-empty.
-    assert(r > 0);
-    assert(c > 0);
-
-    //create an initialize a new matrix
-    path ***A;
-    A = new path**[r];
-    for (int i=0;i<r;++i) {
-      A[i] = new path*[c];
-    }
-    for (int i=0;i<r;i++){
-      for (int j=0;j<c;j++) {
-        A[i][j] = NULL;
-      }
+  path greedy_gnomes_dyn_prog(const grid& setting, path_arena* arena = nullptr) {
+    no_stats stats;
+    return greedy_gnomes_dyn_prog(setting, stats, arena);
+  }
+
+// A cell named in a query.
+struct grid_cell {
+  coordinate row, column;
+};
+
+// Answers questions about best paths to any cell of one grid, not just the
+// overall best path.
+//
+// Building the index fills a dynamic programming table in O(rows*columns)
+// time. After that, the most gold a path to any cell can collect takes O(1)
+// time to look up, and the best path to a cell takes time proportional to its
+// length; neither reads the grid again. Paths refer to the index's own copy
+// of the grid, so they must not outlive the index.
+class best_path_index {
+private:
+  std::unique_ptr<const grid> setting_;
+  dyn_prog_table table_;
+
+public:
+
+  // Build the index for the given grid, which must be non-empty.
+  explicit best_path_index(const grid& setting)
+  : setting_(new grid(setting)) {
+    assert(setting.rows() > 0);
+    assert(setting.columns() > 0);
+    table_.fill(*setting_);
+  }
+
+  // Accessors.
+  const grid& setting() const { return *setting_; }
+  const dyn_prog_table& table() const { return table_; }
+
+  // Return true when some valid path ends at the given cell.
+  bool is_reachable(coordinate row, coordinate column) const {
+    return table_.is_reachable(row, column);
+  }
+
+  // Return the most gold collectable by a path ending at the given cell, or
+  // UNREACHABLE.
+  unsigned max_gold(coordinate row, coordinate column) const {
+    return table_.gold(row, column);
+  }
+
+  // Return the best path ending at the given reachable cell, stored in arena,
+  // or on the heap if it is null. When several paths tie, this is the one
+  // greedy_gnomes_dyn_prog would choose.
+  path path_to(coordinate row, coordinate column, path_arena* arena = nullptr) const {
+    return table_.backtrack(*setting_, row, column, arena);
+  }
+
+  // Answer max_gold for each of the given cells, in order.
+  std::vector<unsigned> max_gold(const std::vector<grid_cell>& cells) const {
+    std::vector<unsigned> result;
+    result.reserve(cells.size());
+    for (auto& c : cells) {
+      result.push_back(max_gold(c.row, c.column));
+    }
+    return result;
+  }
+
+  // Answer path_to for each of the given cells, which must all be reachable,
+  // in order.
+  std::vector<path> paths_to(const std::vector<grid_cell>& cells,
+                             path_arena* arena = nullptr) const {
+    std::vector<path> result;
+    result.reserve(cells.size());
+    for (auto& c : cells) {
+      result.push_back(path_to(c.row, c.column, arena));
     }
+    return result;
+  }
+};
 
-    //base case
-    A[0][0] = new path(setting);
-    path best(setting);
+// The result of a score-only solve: how much gold the best path collects and
+// the cell where that path ends.
+struct gold_score {
+  unsigned total_gold;
+  coordinate final_row, final_column;
+};
 
-    int zero = 0;
-    path from_above(setting);
-    path from_left(setting);
+// Advance a rolling one-row score buffer by one grid row.
+//
+// scores[k] corresponds to column first+k. On entry it holds the scores of
+// the row above (UNREACHABLE where none); on return it holds the scores of
+// the given row, restricted to columns [first, last]. When seed is true the
+// cell (row, first) is the start of the sweep, so it is reachable on its own
+// and contributes its own gold. left_of_first is the score of the cell just
+// left of the range, for sweeps over part of a wider row. When from_left is
+// not null, from_left[k] is set to whether the best path to column first+k
+// takes its last step to the right, preferring the path from above on ties
+// as dyn_prog_table does.
+void dyn_prog_sweep_row(const grid& setting, coordinate row,
+                        coordinate first, coordinate last,
+                        std::vector<unsigned>& scores, bool seed,
+                        unsigned left_of_first = UNREACHABLE,
+                        uint8_t* from_left = nullptr) {
+  assert(first <= last);
+  assert(scores.size() > last - first);
 
-    for (int i=0;i<r;i++){
-      for (int j=0;j<c;j++){
-        if (setting.get(i,j)==CELL_ROCK)
-          continue;
+  for (coordinate j = first; j <= last; ++j) {
+    size_t k = j - first;
+    auto cell = setting.get(row, j);
+    if (cell == CELL_ROCK) {
+      scores[k] = UNREACHABLE;
+      continue;
+    }
 
-        //fromabover = from left = none
-        int *above = NULL;
-        int *left = NULL;
+    unsigned best = scores[k],
+             left = (k > 0) ? scores[k - 1] : left_of_first;
+    bool is_left = false;
+    if (left != UNREACHABLE && (best == UNREACHABLE || left > best)) {
+      best = left;
+      is_left = true;
+    }
+    if (seed && k == 0) {
+      best = 0;
+    }
+    if (from_left) {
+      from_left[k] = is_left;
+    }
 
-        if (i>0 && A[i-1][j] != NULL){
-          from_above = *A[i-1][j];
-          above = &zero;
-          if (from_above.is_step_valid(STEP_DIRECTION_DOWN))
-            from_above.add_step(STEP_DIRECTION_DOWN);
-        }
+    if (best != UNREACHABLE && cell == CELL_GOLD) {
+      ++best;
+    }
+    scores[k] = best;
+  }
+}
 
-        if (j>0 && A[i][j-1] != NULL){
-          from_left = *A[i][j-1];
-          left = &zero;
-          if (from_left.is_step_valid(STEP_DIRECTION_RIGHT))
-            from_left.add_step(STEP_DIRECTION_RIGHT);
-        }
+// Compute only the total gold of an optimal path, and where it ends, for the
+// given grid.
+//
+// This sweeps the grid one row at a time, so it needs O(columns) memory
+// instead of a per-cell table, and the result agrees with the path returned
+// by greedy_gnomes_dyn_prog.
+//
+// The grid must be non-empty.
+gold_score greedy_gnomes_dyn_prog_score(const grid& setting) {
+  assert(setting.rows() > 0);
+  assert(setting.columns() > 0);
 
-        if(above != NULL && left != NULL){
-          if(from_above.total_gold() >= from_left.total_gold())
-            A[i][j] = new path(from_above);
-          else if (from_above.total_gold() < from_left.total_gold())
-            A[i][j] = new path(from_left);
-        }
-        else if(above == NULL && left!= NULL)
-          A[i][j] = new path(from_left);
-        else if (above != NULL && left == NULL)
-          A[i][j] = new path(from_above);
+  const coordinate last = setting.columns() - 1;
+  std::vector<unsigned> scores(setting.columns(), UNREACHABLE);
+  gold_score best = { 0, 0, 0 };
+
+  for (coordinate i = 0; i < setting.rows(); ++i) {
+    dyn_prog_sweep_row(setting, i, 0, last, scores, (i == 0));
+    for (coordinate j = 0; j <= last; ++j) {
+      if (scores[j] != UNREACHABLE && scores[j] > best.total_gold) {
+        best.total_gold = scores[j];
+        best.final_row = i;
+        best.final_column = j;
       }
     }
+  }
 
-    //post processing to find max gold path
-    for (int i=0;i<r;i++)
-      for (int j=0;j<c;j++)
-        if (A[i][j] != NULL && A[i][j]->total_gold() > best.total_gold())
-          best = *A[i][j];
+  return best;
+}
 
-    return best;
+// Mirror image of dyn_prog_sweep_row, for sweeping from the bottom-right
+// corner of a rectangle back towards its top-left.
+//
+// On entry scores holds, for each column, the most gold collectable on a path
+// from the cell below to the end of the sweep (UNREACHABLE where none); on
+// return it holds the same for the given row. When seed is true the cell
+// (row, last) is the end of the sweep.
+void dyn_prog_sweep_row_backward(const grid& setting, coordinate row,
+                                 coordinate first, coordinate last,
+                                 std::vector<unsigned>& scores, bool seed) {
+  assert(first <= last);
+  assert(scores.size() > last - first);
+
+  const size_t width = last - first + 1;
+  for (size_t k = width; k > 0; --k) {
+    auto cell = setting.get(row, first + k - 1);
+    if (cell == CELL_ROCK) {
+      scores[k - 1] = UNREACHABLE;
+      continue;
+    }
+
+    unsigned best = scores[k - 1],
+             right = (k < width) ? scores[k] : UNREACHABLE;
+    if (right != UNREACHABLE && (best == UNREACHABLE || right > best)) {
+      best = right;
+    }
+    if (seed && k == width) {
+      best = 0;
+    }
+
+    if (best != UNREACHABLE && cell == CELL_GOLD) {
+      ++best;
+    }
+    scores[k - 1] = best;
+  }
+}
+
+// Append to steps the moves of a best path from (first_row, first_column) to
+// (last_row, last_column), counting the gold of both end cells. Some path
+// between the two cells must exist.
+//
+// This is Hirschberg's divide and conquer: a forward sweep down to the middle
+// row and a backward sweep up to the row below it find the column where a best
+// path crosses between them, and then each half is solved recursively. The
+// two score buffers are reused at every level of the recursion.
+void linear_space_steps(const grid& setting,
+                        coordinate first_row, coordinate first_column,
+                        coordinate last_row, coordinate last_column,
+                        std::vector<step_direction>& steps,
+                        std::vector<unsigned>& forward,
+                        std::vector<unsigned>& backward) {
+  assert(first_row <= last_row);
+  assert(first_column <= last_column);
+
+  if (first_row == last_row) {
+    steps.insert(steps.end(), last_column - first_column, STEP_DIRECTION_RIGHT);
+    return;
+  }
+
+  const coordinate middle = first_row + (last_row - first_row) / 2;
+  const size_t width = last_column - first_column + 1;
+
+  forward.assign(width, UNREACHABLE);
+  for (coordinate i = first_row; i <= middle; ++i) {
+    dyn_prog_sweep_row(setting, i, first_column, last_column, forward,
+                       (i == first_row));
+  }
+
+  backward.assign(width, UNREACHABLE);
+  for (coordinate i = last_row; i > middle; --i) {
+    dyn_prog_sweep_row_backward(setting, i, first_column, last_column, backward,
+                                (i == last_row));
   }
+
+  // Pick the column where the path steps down from the middle row.
+  size_t crossing = width;
+  unsigned crossing_gold = 0;
+  for (size_t k = 0; k < width; ++k) {
+    if (forward[k] != UNREACHABLE && backward[k] != UNREACHABLE &&
+        (crossing == width || forward[k] + backward[k] > crossing_gold)) {
+      crossing = k;
+      crossing_gold = forward[k] + backward[k];
+    }
+  }
+  assert(crossing < width);
+
+  const coordinate column = first_column + crossing;
+  linear_space_steps(setting, first_row, first_column, middle, column,
+                     steps, forward, backward);
+  steps.push_back(STEP_DIRECTION_DOWN);
+  linear_space_steps(setting, middle + 1, column, last_row, last_column,
+                     steps, forward, backward);
+}
+
+// Solve the greedy gnomes problem for the given grid, using dynamic
+// programming in O(rows+columns) working memory.
+//
+// A score-only sweep finds where the best path ends, then linear_space_steps
+// recovers the path itself. This costs roughly three times the cell visits of
+// greedy_gnomes_dyn_prog, in exchange for never holding a per-cell table. The
+// gold collected always matches greedy_gnomes_dyn_prog, but when several paths
+// tie the two may return different ones.
+//
+// When arena is not null, the returned path is stored in it.
+//
+// The grid must be non-empty.
+path greedy_gnomes_dyn_prog_linear_space(const grid& setting,
+                                         path_arena* arena = nullptr) {
+  auto end = greedy_gnomes_dyn_prog_score(setting);
+
+  std::vector<step_direction> steps;
+  steps.reserve(end.final_row + end.final_column);
+  std::vector<unsigned> forward, backward;
+  linear_space_steps(setting, 0, 0, end.final_row, end.final_column,
+                     steps, forward, backward);
+
+  return path(setting, steps, arena);
+}
 }
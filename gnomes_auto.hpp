@@ -0,0 +1,47 @@
+///////////////////////////////////////////////////////////////////////////////
+// gnomes_auto.hpp
+//
+// Choosing a greedy gnomes solver from the shape and contents of a grid.
+//
+// greedy_gnomes_auto is the entry point for callers that only want the best
+// path and do not care which solver finds it. It sends the fixed shapes of
+// gnomes_fixed.hpp to their compile-time solvers, rock-free grids with little
+// gold to the sparse solver of gnomes_sparse.hpp, and everything else to
+// greedy_gnomes_dyn_prog.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "gnomes_algs.hpp"
+#include "gnomes_fixed.hpp"
+#include "gnomes_sparse.hpp"
+
+namespace gnomes {
+
+// Solve the greedy gnomes problem for the given grid with the fastest
+// suitable solver: greedy_gnomes_fixed for 8x8, 16x16 and 32x32 grids,
+// greedy_gnomes_sparse for other grids without rocks whose gold density is at
+// most SPARSE_GOLD_MAX_DENSITY, and greedy_gnomes_dyn_prog otherwise. The
+// path collects as much gold as greedy_gnomes_dyn_prog's, and is the same
+// path unless the sparse solver is chosen. It is stored in arena, or on the
+// heap if it is null.
+//
+// The grid must be non-empty.
+path greedy_gnomes_auto(const grid& setting, path_arena* arena = nullptr) {
+  if (setting.rows() == 8 && setting.columns() == 8) {
+    return greedy_gnomes_fixed<8, 8>(setting, arena);
+  } else if (setting.rows() == 16 && setting.columns() == 16) {
+    return greedy_gnomes_fixed<16, 16>(setting, arena);
+  } else if (setting.rows() == 32 && setting.columns() == 32) {
+    return greedy_gnomes_fixed<32, 32>(setting, arena);
+  } else if (is_rock_free(setting) &&
+             gold_count(setting) <=
+               SPARSE_GOLD_MAX_DENSITY * setting.rows() * setting.columns()) {
+    return greedy_gnomes_sparse(setting, arena);
+  } else {
+    return greedy_gnomes_dyn_prog(setting, arena);
+  }
+}
+
+}
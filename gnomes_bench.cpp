@@ -0,0 +1,351 @@
+///////////////////////////////////////////////////////////////////////////////
+// gnomes_bench.cpp
+//
+// Benchmark suite for every greedy gnomes solver.
+//
+// For each combination of problem size n (rows + columns), aspect ratio
+// (rows / columns), gold density, rock density and seed, this builds a
+// random grid and times every selected solver: a few warm-up runs, then a
+// number of measured repetitions. It prints the minimum, median and 95th
+// percentile of both wall-clock and processor time, and can also write the
+// results as CSV or JSON for plotting and for comparing commits. Heap
+// allocations made by one call of each solver, and how far the process's
+// resident set grew while its measured runs were going (see RssScope), are
+// recorded next to the times.
+//
+// Exponential solvers have a cap on n, beyond which they are skipped. The
+// top-k solver is run once for each value of --k, named dyn_prog_top_<k>, to
+// show how its cost grows with k. The default sizes include n = 16, 32 and 64,
+// which at aspect 1 are the 8x8, 16x16 and 32x32 shapes that "auto" solves with
+// greedy_gnomes_fixed, so a default run compares it against dyn_prog.
+//
+// Usage:
+//
+//    ./gnomes_bench [--n=10,20,40] [--aspect=1] [--gold=0.2] [--rock=0.1]
+//                   [--seeds=1] [--reps=5] [--warmup=1]
+//                   [--algorithms=dyn_prog,exhaustive,...]
+//                   [--cap=exhaustive:24,...] [--threads=0] [--k=1,4,16]
+//                   [--csv=results.csv] [--json=results.json]
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#define GNOMES_TRACK_ALLOCATIONS
+#include "alloc_tracker.hpp"
+#include "timer.hpp"
+
+#include "gnomes_algs.hpp"
+#include "gnomes_auto.hpp"
+#include "gnomes_fixed.hpp"
+#include "gnomes_parallel.hpp"
+#include "gnomes_simd.hpp"
+#include "gnomes_sparse.hpp"
+#include "gnomes_top_k.hpp"
+
+// One solver to benchmark. run returns the gold it found, which is used to
+// check that all solvers agree.
+struct solver {
+  std::string name;
+  // Largest n this solver is run on; 0 means no cap.
+  size_t max_n;
+  std::function<unsigned(const gnomes::grid&)> run;
+};
+
+// Summary statistics of a set of timings, in seconds.
+struct summary {
+  double min, median, p95;
+};
+
+summary summarize(std::vector<double> samples) {
+  assert(!samples.empty());
+  std::sort(samples.begin(), samples.end());
+  auto at = [&samples](double fraction) {
+    size_t k = size_t(std::ceil(fraction * samples.size()));
+    return samples[std::min(samples.size(), std::max<size_t>(k, 1)) - 1];
+  };
+  return summary{ samples.front(), at(0.5), at(0.95) };
+}
+
+// One row of results.
+struct measurement {
+  std::string algorithm;
+  size_t n;
+  gnomes::coordinate rows, columns;
+  double gold_density, rock_density;
+  unsigned seed, gold;
+  summary wall, cpu;
+  unsigned long long allocations, allocated_bytes, peak_live_bytes;
+  long peak_rss_growth_kilobytes;
+};
+
+// Split a comma-separated option value.
+std::vector<std::string> split(const std::string& list) {
+  std::vector<std::string> result;
+  std::stringstream in(list);
+  std::string item;
+  while (std::getline(in, item, ',')) {
+    if (!item.empty()) {
+      result.push_back(item);
+    }
+  }
+  return result;
+}
+
+std::vector<double> parse_numbers(const std::string& list) {
+  std::vector<double> result;
+  for (auto& item : split(list)) {
+    result.push_back(std::atof(item.c_str()));
+  }
+  return result;
+}
+
+void usage_error(const std::string& message) {
+  std::cerr << "gnomes_bench: " << message << std::endl;
+  std::exit(1);
+}
+
+int main(int argc, char* argv[]) {
+
+  std::map<std::string, std::string> options = {
+    { "n", "10,16,20,30,32,40,64,100,1000" },
+    { "aspect", "1" },
+    { "gold", "0.2" },
+    { "rock", "0.1" },
+    { "seeds", "1" },
+    { "reps", "5" },
+    { "warmup", "1" },
+    { "algorithms", "" },
+    { "cap", "" },
+    { "threads", "0" },
+    { "k", "1,4,16" },
+    { "csv", "" },
+    { "json", "" }
+  };
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    auto equals = arg.find('=');
+    if (arg.compare(0, 2, "--") != 0 || equals == std::string::npos ||
+        !options.count(arg.substr(2, equals - 2))) {
+      usage_error("unknown option " + arg);
+    }
+    options[arg.substr(2, equals - 2)] = arg.substr(equals + 1);
+  }
+
+  ThreadPool pool(std::atoi(options["threads"].c_str()));
+
+  std::vector<solver> solvers = {
+    { "exhaustive", 24,
+      [](const gnomes::grid& g) { return gnomes::greedy_gnomes_exhaustive(g).total_gold(); } },
+    { "exhaustive_parallel", 24,
+      [&pool](const gnomes::grid& g) {
+        return gnomes::greedy_gnomes_exhaustive_parallel(g, pool).total_gold(); } },
+    { "exhaustive_bounded", 40,
+      [](const gnomes::grid& g) { return gnomes::greedy_gnomes_exhaustive_bounded(g).total_gold(); } },
+    { "exhaustive_meet_in_middle", 40,
+      [](const gnomes::grid& g) {
+        return gnomes::greedy_gnomes_exhaustive_meet_in_middle(g).total_gold(); } },
+    { "dyn_prog", 0,
+      [](const gnomes::grid& g) { return gnomes::greedy_gnomes_dyn_prog(g).total_gold(); } },
+    { "auto", 0,
+      [](const gnomes::grid& g) { return gnomes::greedy_gnomes_auto(g).total_gold(); } },
+    { "sparse", 0,
+      [](const gnomes::grid& g) { return gnomes::greedy_gnomes_sparse(g).total_gold(); } },
+    { "dyn_prog_linear_space", 0,
+      [](const gnomes::grid& g) {
+        return gnomes::greedy_gnomes_dyn_prog_linear_space(g).total_gold(); } },
+    { "dyn_prog_score", 0,
+      [](const gnomes::grid& g) { return gnomes::greedy_gnomes_dyn_prog_score(g).total_gold; } },
+    { "dyn_prog_score_wavefront", 0,
+      [](const gnomes::grid& g) {
+        return gnomes::greedy_gnomes_dyn_prog_score_wavefront(g).total_gold; } },
+    { "dyn_prog_parallel", 0,
+      [&pool](const gnomes::grid& g) {
+        return gnomes::greedy_gnomes_dyn_prog_parallel(g, pool).total_gold(); } },
+    { "dyn_prog_score_parallel", 0,
+      [&pool](const gnomes::grid& g) {
+        return gnomes::greedy_gnomes_dyn_prog_score_parallel(g, pool).total_gold; } }
+  };
+
+  for (double k_value : parse_numbers(options["k"])) {
+    size_t k = size_t(k_value);
+    if (k < 1) {
+      usage_error("k must be positive");
+    }
+    solvers.push_back({ "dyn_prog_top_" + std::to_string(k), 0,
+        [k](const gnomes::grid& g) {
+          return gnomes::greedy_gnomes_dyn_prog_top_k(g, k).front().total_gold(); } });
+  }
+
+  // Apply --cap and --algorithms.
+  for (auto& item : split(options["cap"])) {
+    auto colon = item.find(':');
+    auto found = std::find_if(solvers.begin(), solvers.end(), [&](const solver& s) {
+        return s.name == item.substr(0, colon);
+      });
+    if (colon == std::string::npos || found == solvers.end()) {
+      usage_error("bad cap " + item);
+    }
+    found->max_n = std::atoi(item.substr(colon + 1).c_str());
+  }
+  auto selected = split(options["algorithms"]);
+  if (!selected.empty()) {
+    for (auto& name : selected) {
+      if (std::none_of(solvers.begin(), solvers.end(),
+                       [&](const solver& s) { return s.name == name; })) {
+        usage_error("unknown algorithm " + name);
+      }
+    }
+    solvers.erase(std::remove_if(solvers.begin(), solvers.end(), [&](const solver& s) {
+          return std::find(selected.begin(), selected.end(), s.name) == selected.end();
+        }), solvers.end());
+  }
+
+  const int seeds = std::atoi(options["seeds"].c_str()),
+            reps = std::atoi(options["reps"].c_str()),
+            warmup = std::atoi(options["warmup"].c_str());
+  if (seeds < 1 || reps < 1 || warmup < 0) {
+    usage_error("seeds and reps must be positive, warmup non-negative");
+  }
+
+  std::vector<measurement> results;
+  std::cout << std::left
+            << std::setw(26) << "algorithm" << std::right
+            << std::setw(6) << "n" << std::setw(6) << "rows" << std::setw(6) << "cols"
+            << std::setw(6) << "gold%" << std::setw(6) << "rock%" << std::setw(6) << "seed"
+            << std::setw(12) << "wall min" << std::setw(12) << "wall med"
+            << std::setw(12) << "wall p95" << std::setw(12) << "cpu med"
+            << std::setw(10) << "allocs" << std::setw(12) << "peak bytes"
+            << std::setw(10) << "RSS+ KB"
+            << std::endl;
+
+  for (double n_value : parse_numbers(options["n"])) {
+    size_t n = size_t(n_value);
+    if (n < 2) {
+      usage_error("n must be at least 2");
+    }
+    for (double aspect : parse_numbers(options["aspect"])) {
+      gnomes::coordinate rows = gnomes::coordinate(std::lround(n * aspect / (1 + aspect)));
+      rows = std::min<gnomes::coordinate>(std::max<gnomes::coordinate>(rows, 1), n - 1);
+      gnomes::coordinate columns = n - rows;
+      size_t cells = rows * columns;
+
+      for (double gold_density : parse_numbers(options["gold"])) {
+        for (double rock_density : parse_numbers(options["rock"])) {
+          unsigned gold_count = unsigned(cells * gold_density),
+                   rock_count = unsigned(cells * rock_density);
+          if (gold_count + rock_count >= cells) {
+            usage_error("gold and rock densities leave no room for (0, 0)");
+          }
+
+          for (int seed = 1; seed <= seeds; ++seed) {
+            std::mt19937 gen(seed);
+            gnomes::grid input = gnomes::grid::random(rows, columns, gold_count,
+                                                      rock_count, gen);
+
+            bool have_expected = false;
+            unsigned expected = 0;
+            for (auto& s : solvers) {
+              if (s.max_n != 0 && n > s.max_n) {
+                continue;
+              }
+
+              unsigned gold = 0;
+              for (int i = 0; i < warmup; ++i) {
+                gold = s.run(input);
+              }
+              std::vector<double> wall, cpu;
+              AllocationScope allocations;
+              RssScope rss;
+              for (int i = 0; i < reps; ++i) {
+                allocations.reset();
+                Timer timer;
+                CpuTimer cpu_timer;
+                gold = s.run(input);
+                wall.push_back(timer.elapsed());
+                cpu.push_back(cpu_timer.elapsed());
+              }
+
+              if (have_expected && gold != expected) {
+                std::cerr << "gnomes_bench: " << s.name << " found " << gold
+                          << " gold, expected " << expected << std::endl;
+                return 1;
+              }
+              have_expected = true;
+              expected = gold;
+
+              measurement m = { s.name, n, rows, columns, gold_density, rock_density,
+                                unsigned(seed), gold, summarize(wall), summarize(cpu),
+                                allocations.allocations(), allocations.bytes(),
+                                allocations.peak_bytes(), rss.peak_growth_kilobytes() };
+              results.push_back(m);
+              std::cout << std::left << std::setw(26) << s.name << std::right
+                        << std::setw(6) << n << std::setw(6) << rows << std::setw(6) << columns
+                        << std::setw(6) << (100 * gold_density)
+                        << std::setw(6) << (100 * rock_density)
+                        << std::setw(6) << seed
+                        << std::setw(12) << m.wall.min << std::setw(12) << m.wall.median
+                        << std::setw(12) << m.wall.p95 << std::setw(12) << m.cpu.median
+                        << std::setw(10) << m.allocations
+                        << std::setw(12) << m.peak_live_bytes
+                        << std::setw(10) << m.peak_rss_growth_kilobytes
+                        << std::endl;
+            }
+          }
+        }
+      }
+    }
+  }
+
+  if (!options["csv"].empty()) {
+    std::ofstream out(options["csv"]);
+    out << "algorithm,n,rows,columns,gold_density,rock_density,seed,gold,"
+        << "wall_min,wall_median,wall_p95,cpu_min,cpu_median,cpu_p95,"
+        << "allocations,allocated_bytes,peak_live_bytes,peak_rss_growth_kb" << std::endl;
+    for (auto& m : results) {
+      out << m.algorithm << ',' << m.n << ',' << m.rows << ',' << m.columns << ','
+          << m.gold_density << ',' << m.rock_density << ',' << m.seed << ',' << m.gold << ','
+          << m.wall.min << ',' << m.wall.median << ',' << m.wall.p95 << ','
+          << m.cpu.min << ',' << m.cpu.median << ',' << m.cpu.p95 << ','
+          << m.allocations << ',' << m.allocated_bytes << ','
+          << m.peak_live_bytes << ',' << m.peak_rss_growth_kilobytes << std::endl;
+    }
+  }
+
+  if (!options["json"].empty()) {
+    std::ofstream out(options["json"]);
+    out << "[" << std::endl;
+    for (size_t i = 0; i < results.size(); ++i) {
+      auto& m = results[i];
+      out << "  {\"algorithm\": \"" << m.algorithm << "\""
+          << ", \"n\": " << m.n << ", \"rows\": " << m.rows << ", \"columns\": " << m.columns
+          << ", \"gold_density\": " << m.gold_density
+          << ", \"rock_density\": " << m.rock_density
+          << ", \"seed\": " << m.seed << ", \"gold\": " << m.gold
+          << ", \"wall\": {\"min\": " << m.wall.min << ", \"median\": " << m.wall.median
+          << ", \"p95\": " << m.wall.p95 << "}"
+          << ", \"cpu\": {\"min\": " << m.cpu.min << ", \"median\": " << m.cpu.median
+          << ", \"p95\": " << m.cpu.p95 << "}"
+          << ", \"allocations\": " << m.allocations
+          << ", \"allocated_bytes\": " << m.allocated_bytes
+          << ", \"peak_live_bytes\": " << m.peak_live_bytes
+          << ", \"peak_rss_growth_kb\": " << m.peak_rss_growth_kilobytes << "}"
+          << ((i + 1 < results.size()) ? "," : "") << std::endl;
+    }
+    out << "]" << std::endl;
+  }
+
+  return 0;
+}
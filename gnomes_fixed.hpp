@@ -0,0 +1,187 @@
+///////////////////////////////////////////////////////////////////////////////
+// gnomes_fixed.hpp
+//
+// Solving greedy gnomes grids whose dimensions are known at compile time.
+//
+// fixed_grid<R, C> keeps its bitboards in member arrays, and fixed_dyn_prog
+// keeps its table in local arrays, so a solve makes no heap allocations and
+// every loop has a constant trip count the compiler can unroll. When compiled
+// as C++14 or later, both can also be evaluated at compile time, for test
+// fixtures and lookup tables. greedy_gnomes_auto, in gnomes_auto.hpp, uses
+// them for the common shapes.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cassert>
+#include "gnomes_algs.hpp"
+
+// Marks functions that can only be constexpr under C++14's relaxed rules,
+// such as those with loops.
+#if __cplusplus >= 201402L
+#define GNOMES_CONSTEXPR14 constexpr
+#else
+#define GNOMES_CONSTEXPR14
+#endif
+
+namespace gnomes {
+
+// Type for a grid of R rows and C columns, stored as bitboards laid out as
+// grid lays out its own.
+template <coordinate R, coordinate C>
+class fixed_grid {
+  static_assert(R > 0 && C > 0, "a fixed_grid must be non-empty");
+
+public:
+  static constexpr coordinate WORDS_PER_ROW = (C + CELLS_PER_WORD - 1) / CELLS_PER_WORD;
+
+private:
+  row_word gold_[R * WORDS_PER_ROW];
+  row_word rock_[R * WORDS_PER_ROW];
+
+  static constexpr size_t word_index(coordinate row, coordinate column) {
+    return row * WORDS_PER_ROW + column / CELLS_PER_WORD;
+  }
+
+  static constexpr row_word bit(coordinate column) {
+    return row_word(1) << (column % CELLS_PER_WORD);
+  }
+
+public:
+
+  // Create a grid of CELL_EARTH.
+  GNOMES_CONSTEXPR14 fixed_grid()
+  : gold_(), rock_() { }
+
+  // Copy the given grid, which must have R rows and C columns.
+  explicit fixed_grid(const grid& setting)
+  : gold_(), rock_() {
+    assert(setting.rows() == R);
+    assert(setting.columns() == C);
+    for (coordinate i = 0; i < R; ++i) {
+      for (coordinate w = 0; w < WORDS_PER_ROW; ++w) {
+        gold_[i * WORDS_PER_ROW + w] = setting.gold_row(i)[w];
+        rock_[i * WORDS_PER_ROW + w] = setting.rock_row(i)[w];
+      }
+    }
+  }
+
+  // Accessors.
+  static constexpr coordinate rows() { return R; }
+  static constexpr coordinate columns() { return C; }
+
+  // Return the cell at the given row and column.
+  GNOMES_CONSTEXPR14 cell_kind get(coordinate row, coordinate column) const {
+    assert(row < R && column < C);
+    return (gold_[word_index(row, column)] & bit(column)) ? CELL_GOLD
+           : (rock_[word_index(row, column)] & bit(column)) ? CELL_ROCK
+           : CELL_EARTH;
+  }
+
+  // Set the contents of the cell at the given row and column. (0, 0) may only
+  // be CELL_EARTH.
+  GNOMES_CONSTEXPR14 void set(coordinate row, coordinate column, cell_kind kind) {
+    assert(row < R && column < C);
+    assert((row != 0 || column != 0) || kind == CELL_EARTH);
+    const size_t w = word_index(row, column);
+    gold_[w] &= ~bit(column);
+    rock_[w] &= ~bit(column);
+    if (kind == CELL_GOLD) {
+      gold_[w] |= bit(column);
+    } else if (kind == CELL_ROCK) {
+      rock_[w] |= bit(column);
+    }
+  }
+};
+
+// A path found by fixed_dyn_prog, with its moves packed one bit each as path
+// does (1 for right, 0 for down).
+template <coordinate R, coordinate C>
+struct fixed_path {
+  static constexpr size_t MOVE_WORDS = (R + C - 2) / CELLS_PER_WORD + 1;
+
+  row_word moves[MOVE_WORDS];
+  coordinate final_row, final_column;
+  unsigned total_gold;
+
+  // Return true if the step entering the given cell on the path is to the
+  // right.
+  constexpr bool is_from_left(coordinate row, coordinate column) const {
+    return (moves[(row + column - 1) / CELLS_PER_WORD] >>
+            ((row + column - 1) % CELLS_PER_WORD)) & 1;
+  }
+
+  // Convert to a path in the given grid, which must be the one that was
+  // solved, stored in arena, or on the heap if it is null.
+  path to_path(const grid& setting, path_arena* arena = nullptr) const {
+    return path(setting, final_row, final_column, total_gold,
+                [this](coordinate i, coordinate j) { return is_from_left(i, j); },
+                arena);
+  }
+};
+
+// Solve the greedy gnomes problem for the given fixed-size grid, by the same
+// dynamic programming as greedy_gnomes_dyn_prog, with the same tie-breaking,
+// so the path is the one it would return.
+template <coordinate R, coordinate C>
+GNOMES_CONSTEXPR14 fixed_path<R, C> fixed_dyn_prog(const fixed_grid<R, C>& setting) {
+  unsigned gold[R * C] = {};
+  bool from_left[R * C] = {};
+
+  coordinate best_row = 0, best_column = 0;
+  for (coordinate i = 0; i < R; ++i) {
+    for (coordinate j = 0; j < C; ++j) {
+      const size_t k = i * C + j;
+      gold[k] = UNREACHABLE;
+      auto cell = setting.get(i, j);
+      if (cell == CELL_ROCK) {
+        continue;
+      }
+
+      unsigned above = (i > 0) ? gold[k - C] : UNREACHABLE,
+               left = (j > 0) ? gold[k - 1] : UNREACHABLE,
+               best = UNREACHABLE;
+      if (i == 0 && j == 0) {
+        best = 0;
+      } else if (above != UNREACHABLE &&
+                 (left == UNREACHABLE || above >= left)) {
+        best = above;
+      } else if (left != UNREACHABLE) {
+        best = left;
+        from_left[k] = true;
+      } else {
+        continue;
+      }
+
+      gold[k] = best + ((cell == CELL_GOLD) ? 1 : 0);
+      if (gold[k] > gold[best_row * C + best_column]) {
+        best_row = i;
+        best_column = j;
+      }
+    }
+  }
+
+  fixed_path<R, C> result = { {}, best_row, best_column,
+                              gold[best_row * C + best_column] };
+  coordinate row = best_row, column = best_column;
+  for (size_t k = row + column; k > 0; --k) {
+    if (from_left[row * C + column]) {
+      result.moves[(k - 1) / CELLS_PER_WORD] |= row_word(1) << ((k - 1) % CELLS_PER_WORD);
+      --column;
+    } else {
+      --row;
+    }
+  }
+  return result;
+}
+
+// Solve the given grid, which must have R rows and C columns, with
+// fixed_dyn_prog, and return the path stored in arena, or on the heap if it
+// is null.
+template <coordinate R, coordinate C>
+path greedy_gnomes_fixed(const grid& setting, path_arena* arena = nullptr) {
+  return fixed_dyn_prog(fixed_grid<R, C>(setting)).to_path(setting, arena);
+}
+
+}
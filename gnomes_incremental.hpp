@@ -0,0 +1,224 @@
+///////////////////////////////////////////////////////////////////////////////
+// gnomes_incremental.hpp
+//
+// Re-solving the greedy gnomes problem after small changes to the grid.
+//
+// Changing cell (r, c) can only change the dynamic programming values of cells
+// below and to the right of it, and usually only of a few of those: once a
+// recomputed cell holds the same gold as before, nothing that depends on it
+// alone needs recomputing. incremental_dyn_prog keeps its grid and table
+// between solves and recomputes only along that frontier.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <vector>
+#include "gnomes_algs.hpp"
+
+namespace gnomes {
+
+// One change to a grid: the cell at row, column becomes kind.
+struct cell_edit {
+  coordinate row, column;
+  cell_kind kind;
+};
+
+// Dynamic programming solver that keeps its state between solves, so that
+// after a batch of cell edits only the cells whose gold may change are
+// recomputed.
+//
+// Every path it returns is the one greedy_gnomes_dyn_prog would return for the
+// edited grid.
+class incremental_dyn_prog {
+private:
+  grid setting_;
+  dyn_prog_table table_;
+  // For each row, the first column holding the row's most gold, or columns()
+  // if no cell of the row is reachable.
+  std::vector<coordinate> row_best_;
+  // Marks the columns whose gold changed in the row above, and in the current
+  // row, while applying edits. Both are all false between calls.
+  std::vector<bool> changed_above_, changed_here_;
+
+  // Return a copy of setting that owns its storage, so it can be edited.
+  static grid owned_copy(const grid& setting) {
+    if (!setting.is_view()) {
+      return setting;
+    }
+    grid result(setting.rows(), setting.columns());
+    for (coordinate i = 0; i < setting.rows(); ++i) {
+      for (coordinate j = 0; j < setting.columns(); ++j) {
+        auto kind = setting.get(i, j);
+        if (kind != CELL_EARTH) {
+          result.set(i, j, kind);
+        }
+      }
+    }
+    return result;
+  }
+
+  void find_row_best(coordinate row) {
+    coordinate best = setting_.columns();
+    for (coordinate j = 0; j < setting_.columns(); ++j) {
+      if (table_.is_reachable(row, j) &&
+          (best == setting_.columns() || table_.gold(row, j) > table_.gold(row, best))) {
+        best = j;
+      }
+    }
+    row_best_[row] = best;
+  }
+
+public:
+
+  // Create a solver for a copy of the given grid, which must be non-empty,
+  // and fill its table.
+  explicit incremental_dyn_prog(const grid& setting)
+  : setting_(owned_copy(setting)),
+    row_best_(setting.rows()),
+    changed_above_(setting.columns(), false),
+    changed_here_(setting.columns(), false) {
+
+    table_.fill(setting_);
+    for (coordinate i = 0; i < setting_.rows(); ++i) {
+      find_row_best(i);
+    }
+  }
+
+  // Accessors. The grid includes every edit applied so far.
+  const grid& setting() const { return setting_; }
+  const dyn_prog_table& table() const { return table_; }
+
+  // Return the best path for the current grid, stored in arena, or on the
+  // heap if it is null. Takes O(rows+columns) time.
+  path best_path(path_arena* arena = nullptr) const {
+    coordinate best_row = 0, best_column = 0;
+    for (coordinate i = 0; i < setting_.rows(); ++i) {
+      coordinate j = row_best_[i];
+      if (j < setting_.columns() &&
+          table_.gold(i, j) > table_.gold(best_row, best_column)) {
+        best_row = i;
+        best_column = j;
+      }
+    }
+    return table_.backtrack(setting_, best_row, best_column, arena);
+  }
+
+  // Apply the given edits to the grid, update the table, and return the new
+  // best path, as best_path does. Edits follow the rules of grid::set; when
+  // several edit the same cell, the last one wins.
+  //
+  // Cells are recomputed row by row, starting from the first edited cell. In
+  // each row only edited cells, and cells whose neighbor above or to the left
+  // changed, are recomputed, and the update stops as soon as a row has no
+  // changes and no later edits remain. Rows with a changed cell are rescanned
+  // for their best cell. The update is reported to stats; cells_relaxed
+  // counts the cells recomputed.
+  template <typename Stats>
+  path apply(const std::vector<cell_edit>& edits, Stats& stats,
+             path_arena* arena = nullptr) {
+    const coordinate rows = setting_.rows(),
+                     columns = setting_.columns();
+
+    stats.begin_phase(PHASE_INIT);
+    std::vector<cell_edit> sorted(edits);
+    std::stable_sort(sorted.begin(), sorted.end(),
+                     [](const cell_edit& a, const cell_edit& b) {
+                       return (a.row < b.row) || (a.row == b.row && a.column < b.column);
+                     });
+    for (auto& e : sorted) {
+      setting_.set(e.row, e.column, e.kind);
+    }
+    stats.end_phase(PHASE_INIT);
+
+    stats.begin_phase(PHASE_FILL);
+    size_t next = 0;
+    // Range of the columns marked in changed_above_, when any_above is true.
+    bool any_above = false;
+    coordinate above_first = 0, above_last = 0;
+    coordinate row = sorted.empty() ? rows : sorted.front().row;
+    while (row < rows) {
+      auto is_edited_row = [&]() {
+        return next < sorted.size() && sorted[next].row == row;
+      };
+
+      coordinate first = columns;
+      if (any_above) {
+        first = above_first;
+      }
+      if (is_edited_row()) {
+        first = std::min(first, sorted[next].column);
+      }
+
+      bool any_here = false, left_changed = false;
+      coordinate here_first = 0, here_last = 0;
+      for (coordinate j = first; j < columns; ++j) {
+        bool edited = false;
+        while (is_edited_row() && sorted[next].column == j) {
+          edited = true;
+          ++next;
+        }
+        bool above_changed = any_above && j >= above_first && j <= above_last &&
+                             changed_above_[j];
+
+        if (!edited && !above_changed && !left_changed) {
+          if ((!any_above || j > above_last) && !is_edited_row()) {
+            break;
+          }
+          continue;
+        }
+
+        stats.count_cell_relaxed();
+        left_changed = table_.relax(setting_, row, j);
+        if (left_changed) {
+          changed_here_[j] = true;
+          if (!any_here) {
+            here_first = j;
+          }
+          here_last = j;
+          any_here = true;
+        }
+      }
+
+      if (any_here) {
+        find_row_best(row);
+      }
+      if (any_above) {
+        std::fill(changed_above_.begin() + above_first,
+                  changed_above_.begin() + above_last + 1, false);
+      }
+      std::swap(changed_above_, changed_here_);
+      any_above = any_here;
+      above_first = here_first;
+      above_last = here_last;
+
+      ++row;
+      if (!any_above) {
+        if (next == sorted.size()) {
+          break;
+        }
+        row = sorted[next].row;
+      }
+    }
+    if (any_above) {
+      std::fill(changed_above_.begin() + above_first,
+                changed_above_.begin() + above_last + 1, false);
+    }
+    stats.end_phase(PHASE_FILL);
+
+    stats.begin_phase(PHASE_POST);
+    auto best = best_path(arena);
+    stats.count_path_copy();
+    stats.end_phase(PHASE_POST);
+    return best;
+  }
+
+  path apply(const std::vector<cell_edit>& edits, path_arena* arena = nullptr) {
+    no_stats stats;
+    return apply(edits, stats, arena);
+  }
+};
+
+}
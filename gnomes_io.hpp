@@ -0,0 +1,259 @@
+///////////////////////////////////////////////////////////////////////////////
+// gnomes_io.hpp
+//
+// Reading and writing greedy gnomes grids.
+//
+// The binary grid format is a 32-byte header followed by the grid's two
+// bitboards exactly as gnomes::grid stores them in memory:
+//
+//   bytes  0-7   magic "GNOMGRID"
+//   bytes  8-11  format version (GRID_FILE_VERSION), little-endian uint32
+//   bytes 12-15  cell encoding (GRID_ENCODING_BITBOARD), little-endian uint32
+//   bytes 16-23  rows, little-endian uint64
+//   bytes 24-31  columns, little-endian uint64
+//   then         rows * words_per_row gold words, little-endian uint64
+//   then         rows * words_per_row rock words, little-endian uint64
+//
+// Because the payload needs no decoding, map_grid_binary can memory-map a
+// file and hand the solvers a grid view of the mapped pages directly. This
+// uses POSIX mmap and assumes a little-endian host.
+//
+// Grids may also be read from the text form that grid::printable produces.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "gnomes_types.hpp"
+
+namespace gnomes {
+
+const char GRID_FILE_MAGIC[8] = { 'G', 'N', 'O', 'M', 'G', 'R', 'I', 'D' };
+const uint32_t GRID_FILE_VERSION = 1;
+const uint32_t GRID_ENCODING_BITBOARD = 1;
+
+// Header at the start of a binary grid file.
+struct grid_file_header {
+  char magic[8];
+  uint32_t version;
+  uint32_t encoding;
+  uint64_t rows;
+  uint64_t columns;
+};
+
+static_assert(sizeof(grid_file_header) == 32, "grid_file_header must be packed");
+
+// Return true if this machine stores integers little-endian, as the binary
+// grid format does.
+bool is_little_endian() {
+  const uint32_t one = 1;
+  unsigned char first;
+  std::memcpy(&first, &one, 1);
+  return first == 1;
+}
+
+// Write the given grid to a file in the binary grid format. Throws
+// std::runtime_error if the file cannot be written.
+void write_grid_binary(const grid& setting, const std::string& filename) {
+  if (!is_little_endian()) {
+    throw std::runtime_error("binary grid files require a little-endian host");
+  }
+
+  grid_file_header header;
+  std::memcpy(header.magic, GRID_FILE_MAGIC, sizeof(header.magic));
+  header.version = GRID_FILE_VERSION;
+  header.encoding = GRID_ENCODING_BITBOARD;
+  header.rows = setting.rows();
+  header.columns = setting.columns();
+
+  std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  const std::streamsize board_bytes =
+    setting.rows() * setting.words_per_row() * sizeof(row_word);
+  out.write(reinterpret_cast<const char*>(setting.gold_row(0)), board_bytes);
+  out.write(reinterpret_cast<const char*>(setting.rock_row(0)), board_bytes);
+  out.close();
+  if (!out) {
+    throw std::runtime_error("cannot write grid file " + filename);
+  }
+}
+
+// Memory-map the whole of the given file read-only. The mapping lasts as long
+// as the returned pointer or any copy of it. Throws std::runtime_error if the
+// file cannot be opened or is empty.
+std::shared_ptr<const void> map_file(const std::string& filename, size_t& size) {
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("cannot open file " + filename);
+  }
+  struct stat info;
+  if (fstat(fd, &info) != 0 || info.st_size == 0) {
+    close(fd);
+    throw std::runtime_error("file " + filename + " is empty");
+  }
+
+  size = info.st_size;
+  void* address = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (address == MAP_FAILED) {
+    throw std::runtime_error("cannot map file " + filename);
+  }
+  const size_t length = size;
+  return std::shared_ptr<const void>(address, [length](const void* p) {
+      munmap(const_cast<void*>(p), length);
+    });
+}
+
+// Memory-map a binary grid file and return a read-only grid view of it.
+// Nothing is copied: cells are read from the mapped pages on demand, and the
+// mapping lasts as long as the returned grid or any copy of it.
+//
+// The header and file size are validated, and so is the rule that (0, 0) is
+// CELL_EARTH; the rest of the payload is trusted. Throws std::runtime_error
+// if the file cannot be opened or is not a valid grid file.
+grid map_grid_binary(const std::string& filename) {
+  if (!is_little_endian()) {
+    throw std::runtime_error("binary grid files require a little-endian host");
+  }
+
+  size_t size;
+  auto mapping = map_file(filename, size);
+  const char* address = static_cast<const char*>(mapping.get());
+  if (size < sizeof(grid_file_header)) {
+    throw std::runtime_error("grid file " + filename + " is too short");
+  }
+
+  grid_file_header header;
+  std::memcpy(&header, address, sizeof(header));
+  if (std::memcmp(header.magic, GRID_FILE_MAGIC, sizeof(header.magic)) != 0 ||
+      header.version != GRID_FILE_VERSION ||
+      header.encoding != GRID_ENCODING_BITBOARD ||
+      header.rows == 0 || header.columns == 0) {
+    throw std::runtime_error(filename + " is not a supported grid file");
+  }
+
+  // Every product is checked before it is formed, so a crafted header cannot
+  // wrap the expected size around to match a small file.
+  const uint64_t words_per_row = header.columns / CELLS_PER_WORD +
+                                 ((header.columns % CELLS_PER_WORD) ? 1 : 0),
+                 board_words = header.rows * words_per_row;
+  if (board_words / header.rows != words_per_row ||
+      board_words > (SIZE_MAX - sizeof(header)) / (2 * sizeof(row_word)) ||
+      size != sizeof(header) + 2 * board_words * sizeof(row_word)) {
+    throw std::runtime_error("grid file " + filename + " has the wrong size");
+  }
+
+  auto gold = reinterpret_cast<const row_word*>(address + sizeof(header));
+  auto rock = gold + board_words;
+  if ((gold[0] | rock[0]) & 1) {
+    throw std::runtime_error("grid file " + filename + " does not start on earth");
+  }
+
+  return grid::view(header.rows, header.columns, gold, rock, mapping);
+}
+
+// Build a grid from text in the form produced by grid::printable, with one
+// line per row: '.' for earth, 'g' for gold, and 'X' for rock. The '+' and
+// 'G' marks that path::printable adds are read as earth and gold. Lines may
+// end in "\n" or "\r\n", and the last line break is optional.
+//
+// The text is scanned in place, with no per-line allocation: one pass finds
+// the dimensions and a second fills in the cells. Throws std::runtime_error,
+// naming the offending line, if a row's width differs from the first row's,
+// a character is not a cell, or (0, 0) is not earth.
+grid parse_grid_text(const char* text, size_t size) {
+  const char* end = text + size;
+  if (size > 0 && end[-1] == '\n') {
+    --end;
+  }
+
+  // Return the end of the line starting at p, not counting any "\r". A line
+  // starting at or past the end is empty; checking that first also keeps
+  // memchr's length visibly non-negative for optimizing compilers.
+  auto line_end = [end](const char* p) {
+    if (p >= end) {
+      return p;
+    }
+    auto newline = static_cast<const char*>(std::memchr(p, '\n', end - p));
+    auto stop = newline ? newline : end;
+    if (stop > p && stop[-1] == '\r') {
+      --stop;
+    }
+    return stop;
+  };
+
+  coordinate rows = 0;
+  for (const char* p = text; p < end; ++p) {
+    p = static_cast<const char*>(std::memchr(p, '\n', end - p));
+    ++rows;
+    if (!p) {
+      break;
+    }
+  }
+  const coordinate columns = line_end(text) - text;
+  if (rows == 0 || columns == 0) {
+    throw std::runtime_error("grid text is empty");
+  }
+
+  grid result(rows, columns);
+  const char* line = text;
+  for (coordinate row = 0; row < rows; ++row) {
+    const char* stop = line_end(line);
+    if (coordinate(stop - line) != columns) {
+      throw std::runtime_error("grid text line " + std::to_string(row + 1) +
+                               " has " + std::to_string(stop - line) +
+                               " cells, expected " + std::to_string(columns));
+    }
+
+    for (coordinate column = 0; column < columns; ++column) {
+      cell_kind kind;
+      switch (line[column]) {
+      case '.':
+      case '+':
+        continue;
+      case 'g':
+      case 'G':
+        kind = CELL_GOLD;
+        break;
+      case 'X':
+        kind = CELL_ROCK;
+        break;
+      default:
+        throw std::runtime_error("grid text line " + std::to_string(row + 1) +
+                                 " has an unknown cell '" + line[column] + "'");
+      }
+      if (row == 0 && column == 0) {
+        throw std::runtime_error("grid text does not start on earth");
+      }
+      result.set(row, column, kind);
+    }
+
+    line = (row + 1 < rows)
+           ? static_cast<const char*>(std::memchr(stop, '\n', end - stop)) + 1
+           : end;
+  }
+
+  return result;
+}
+
+// Memory-map a text grid file and parse it with parse_grid_text.
+grid load_grid_text(const std::string& filename) {
+  size_t size;
+  auto mapping = map_file(filename, size);
+  return parse_grid_text(static_cast<const char*>(mapping.get()), size);
+}
+
+}
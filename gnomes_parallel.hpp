@@ -0,0 +1,490 @@
+///////////////////////////////////////////////////////////////////////////////
+// gnomes_parallel.hpp
+//
+// Multi-threaded algorithms for the greedy gnomes problem, built on the
+// ThreadPool in thread_pool.hpp.
+//
+// Programs that include this file must be compiled and linked with threads
+// enabled (-pthread).
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+#include "gnomes_algs.hpp"
+#include "gnomes_simd.hpp"
+#include "thread_pool.hpp"
+
+namespace gnomes {
+
+// Helper for greedy_gnomes_exhaustive_parallel. Walks the search tree of
+// exhaustive_search down to the given depth, appending each shallower path
+// and each path at that depth to prefixes in the order exhaustive_search
+// would visit them. is_task records which ones are roots of whole subtrees.
+void exhaustive_prefixes(path& candidate, size_t depth,
+                         std::vector<path>& prefixes,
+                         std::vector<bool>& is_task) {
+  prefixes.push_back(candidate);
+  is_task.push_back(depth == 0);
+  if (depth == 0) {
+    return;
+  }
+
+  for (auto dir : {STEP_DIRECTION_DOWN, STEP_DIRECTION_RIGHT}) {
+    if (candidate.is_step_valid(dir)) {
+      candidate.add_step(dir);
+      exhaustive_prefixes(candidate, depth - 1, prefixes, is_task);
+      candidate.pop_step();
+    }
+  }
+}
+
+// Return the prefix length greedy_gnomes_exhaustive_parallel uses when none
+// is given: the fewest moves k with 2^k >= 8*workers. Cutting the search tree
+// there gives up to eight tasks per worker, or fewer where rocks and edges
+// prune prefixes, which leaves work for idle workers to steal when subtrees
+// turn out uneven.
+size_t exhaustive_prefix_steps(size_t workers) {
+  size_t prefix_steps = 0;
+  while ((size_t(1) << prefix_steps) < 8 * workers) {
+    ++prefix_steps;
+  }
+  return prefix_steps;
+}
+
+// Solve the greedy gnomes problem for the given grid, using an exhaustive
+// search spread over the workers of the given pool.
+//
+// The search tree is cut after its first prefix_steps moves, and the subtree
+// under every prefix of that length becomes one task; with zero prefix steps
+// the whole search is one task. Prefixes longer than a complete path are cut
+// to its length. Each task searches with its own best path, and the results
+// are then reduced in the order the serial search visits them, so this
+// returns exactly the same path as greedy_gnomes_exhaustive.
+//
+// The grid must be non-empty.
+path greedy_gnomes_exhaustive_parallel(const grid& setting, ThreadPool& pool,
+                                       size_t prefix_steps) {
+  assert(setting.rows() > 0);
+  assert(setting.columns() > 0);
+
+  const size_t max_moves = setting.rows() + setting.columns() - 2;
+  prefix_steps = std::min(prefix_steps, max_moves);
+
+  std::vector<path> results;
+  std::vector<bool> is_task;
+  path candidate(setting);
+  exhaustive_prefixes(candidate, prefix_steps, results, is_task);
+
+  for (size_t i = 0; i < results.size(); ++i) {
+    if (is_task[i]) {
+      pool.submit([&results, i]() {
+          path local(results[i]), local_best(results[i]);
+          exhaustive_search(local, local_best);
+          results[i] = local_best;
+        });
+    }
+  }
+  pool.wait();
+
+  path best(setting);
+  for (auto& result : results) {
+    if (result.total_gold() > best.total_gold()) {
+      best = result;
+    }
+  }
+  return best;
+}
+
+// As above, with exhaustive_prefix_steps(pool.size()) prefix steps.
+path greedy_gnomes_exhaustive_parallel(const grid& setting, ThreadPool& pool) {
+  return greedy_gnomes_exhaustive_parallel(setting, pool,
+                                           exhaustive_prefix_steps(pool.size()));
+}
+
+// Return true if score a beats score b: more gold, or the same gold ending
+// earlier in row-major order.
+bool is_better_score(const gold_score& a, const gold_score& b) {
+  if (a.total_gold != b.total_gold) {
+    return a.total_gold > b.total_gold;
+  } else if (a.final_row != b.final_row) {
+    return a.final_row < b.final_row;
+  } else {
+    return a.final_column < b.final_column;
+  }
+}
+
+// Dimensions of the tiles that a tiled wavefront cuts a grid into.
+struct tile_shape {
+  coordinate rows, columns;
+};
+
+// Largest tile side chosen by wavefront_tile_shape. A tile's rolling score
+// buffer of this many columns, and the bitboard words it reads, stay within a
+// core's L1 cache.
+const coordinate WAVEFRONT_MAX_TILE_SIDE = 512;
+
+// Smallest tile side chosen by wavefront_tile_shape, below which scheduling a
+// tile costs more than filling it.
+const coordinate WAVEFRONT_MIN_TILE_SIDE = 16;
+
+// Choose the tiles for a tiled wavefront over a grid of the given dimensions
+// on the given number of threads. Each side is the grid's extent divided by
+// threads, so the grid is at least threads tiles across and down and the
+// middle anti-diagonals of tiles keep every thread busy, clamped to
+// [WAVEFRONT_MIN_TILE_SIDE, WAVEFRONT_MAX_TILE_SIDE].
+tile_shape wavefront_tile_shape(coordinate rows, coordinate columns,
+                                size_t threads) {
+  assert(threads > 0);
+  auto side = [threads](coordinate cells) {
+    coordinate s = coordinate(cells / threads);
+    return std::max(WAVEFRONT_MIN_TILE_SIDE, std::min(WAVEFRONT_MAX_TILE_SIDE, s));
+  };
+  return tile_shape{ side(rows), side(columns) };
+}
+
+// Helper for the tiled wavefront solvers. Fills the given grid tile by tile on
+// the workers of pool and returns the best score, as
+// greedy_gnomes_dyn_prog_score_parallel describes.
+//
+// When from_left is not null, each tile also records whether the best path to
+// each of its cells takes its last step to the right, at index
+// row*columns+column. The flags are one byte each so that tiles never write
+// to the same memory.
+gold_score dyn_prog_tiled_wavefront(const grid& setting, ThreadPool& pool,
+                                    tile_shape tiles,
+                                    std::vector<uint8_t>* from_left) {
+  assert(setting.rows() > 0);
+  assert(setting.columns() > 0);
+  assert(tiles.rows > 0);
+  assert(tiles.columns > 0);
+
+  const coordinate r = setting.rows(),
+                   c = setting.columns(),
+                   tile_rows = tiles.rows,
+                   tile_columns = tiles.columns,
+                   tiles_down = (r + tile_rows - 1) / tile_rows,
+                   tiles_across = (c + tile_columns - 1) / tile_columns;
+
+  if (from_left) {
+    from_left->assign(r * c, 0);
+  }
+
+  // bottom[j] is the score of column j in the lowest row filled so far, and
+  // right[i] the score of row i in the rightmost column filled so far.
+  std::vector<unsigned> bottom(c, UNREACHABLE), right(r, UNREACHABLE);
+  std::vector<gold_score> tile_best(tiles_down * tiles_across);
+
+  // Number of unfinished predecessors of each tile.
+  std::vector<std::atomic<int>> waiting(tiles_down * tiles_across);
+  for (coordinate ti = 0; ti < tiles_down; ++ti) {
+    for (coordinate tj = 0; tj < tiles_across; ++tj) {
+      waiting[ti * tiles_across + tj] = (ti > 0) + (tj > 0);
+    }
+  }
+
+  std::function<void(coordinate, coordinate)> fill_tile =
+    [&](coordinate ti, coordinate tj) {
+      const coordinate first_row = ti * tile_rows,
+                       last_row = std::min(r, first_row + tile_rows) - 1,
+                       first_column = tj * tile_columns,
+                       last_column = std::min(c, first_column + tile_columns) - 1;
+
+      std::vector<unsigned> scores(bottom.begin() + first_column,
+                                   bottom.begin() + last_column + 1);
+      gold_score best = { 0, 0, 0 };
+      for (coordinate i = first_row; i <= last_row; ++i) {
+        unsigned left = (first_column > 0) ? right[i] : UNREACHABLE;
+        dyn_prog_sweep_row(setting, i, first_column, last_column, scores,
+                           (i == 0 && first_column == 0), left,
+                           from_left ? &(*from_left)[size_t(i) * c + first_column] : nullptr);
+        for (coordinate k = 0; k < scores.size(); ++k) {
+          if (scores[k] != UNREACHABLE && scores[k] > best.total_gold) {
+            best.total_gold = scores[k];
+            best.final_row = i;
+            best.final_column = first_column + k;
+          }
+        }
+        right[i] = scores.back();
+      }
+      std::copy(scores.begin(), scores.end(), bottom.begin() + first_column);
+      tile_best[ti * tiles_across + tj] = best;
+
+      if (ti + 1 < tiles_down && --waiting[(ti + 1) * tiles_across + tj] == 0) {
+        pool.submit([&fill_tile, ti, tj]() { fill_tile(ti + 1, tj); });
+      }
+      if (tj + 1 < tiles_across && --waiting[ti * tiles_across + tj + 1] == 0) {
+        pool.submit([&fill_tile, ti, tj]() { fill_tile(ti, tj + 1); });
+      }
+    };
+
+  pool.submit([&fill_tile]() { fill_tile(0, 0); });
+  pool.wait();
+
+  gold_score best = { 0, 0, 0 };
+  for (auto& tile : tile_best) {
+    if (is_better_score(tile, best)) {
+      best = tile;
+    }
+  }
+  return best;
+}
+
+// Compute only the total gold of an optimal path, and where it ends, for the
+// given grid, using the workers of the given pool.
+//
+// The grid is cut into tiles of tile_rows by tile_columns cells, which are
+// filled as a wavefront: a tile is submitted to the pool as soon as the tile
+// above it and the tile to its left have finished. Tiles exchange only their
+// boundary scores, through one shared array holding the last computed score of
+// every column and one holding the last computed score of every row. The
+// result is identical to greedy_gnomes_dyn_prog_score.
+//
+// The grid must be non-empty.
+gold_score greedy_gnomes_dyn_prog_score_parallel(const grid& setting,
+                                                 ThreadPool& pool,
+                                                 coordinate tile_rows,
+                                                 coordinate tile_columns) {
+  return dyn_prog_tiled_wavefront(setting, pool,
+                                  tile_shape{ tile_rows, tile_columns }, nullptr);
+}
+
+// As above, with tiles chosen by wavefront_tile_shape for the grid and the
+// pool's size.
+gold_score greedy_gnomes_dyn_prog_score_parallel(const grid& setting,
+                                                 ThreadPool& pool) {
+  return dyn_prog_tiled_wavefront(setting, pool,
+                                  wavefront_tile_shape(setting.rows(), setting.columns(),
+                                                       pool.size()),
+                                  nullptr);
+}
+
+// Solve the greedy gnomes problem for the given grid by the same tiled
+// wavefront as greedy_gnomes_dyn_prog_score_parallel, returning the path that
+// greedy_gnomes_dyn_prog would return.
+//
+// Besides the boundary scores, every tile records one predecessor flag per
+// cell in a shared rows*columns byte array, which the path is rebuilt from
+// once all tiles have finished. The path is stored in arena, or on the heap
+// if it is null.
+//
+// The grid must be non-empty.
+path greedy_gnomes_dyn_prog_parallel(const grid& setting, ThreadPool& pool,
+                                     coordinate tile_rows, coordinate tile_columns,
+                                     path_arena* arena = nullptr) {
+  std::vector<uint8_t> from_left;
+  auto best = dyn_prog_tiled_wavefront(setting, pool,
+                                       tile_shape{ tile_rows, tile_columns },
+                                       &from_left);
+  const coordinate c = setting.columns();
+  return path(setting, best.final_row, best.final_column, best.total_gold,
+              [&from_left, c](coordinate i, coordinate j) {
+                return from_left[size_t(i) * c + j] != 0;
+              },
+              arena);
+}
+
+// As above, with tiles chosen by wavefront_tile_shape for the grid and the
+// pool's size.
+path greedy_gnomes_dyn_prog_parallel(const grid& setting, ThreadPool& pool,
+                                     path_arena* arena = nullptr) {
+  auto tiles = wavefront_tile_shape(setting.rows(), setting.columns(), pool.size());
+  return greedy_gnomes_dyn_prog_parallel(setting, pool, tiles.rows, tiles.columns,
+                                         arena);
+}
+
+// Solve the greedy gnomes problem for every grid in settings, using dynamic
+// programming, and return the paths in the same order.
+//
+// This is meant for throughput on many small grids. Grids are handed out in
+// chunks of chunk_size. With a pool, chunks run on its workers; without one,
+// they run on the calling thread. Each worker, and the calling thread, reuses
+// one dyn_prog_table for every grid it solves. Each path equals what
+// greedy_gnomes_dyn_prog returns.
+std::vector<path> greedy_gnomes_dyn_prog_batch(const std::vector<grid>& settings,
+                                               ThreadPool* pool = nullptr,
+                                               size_t chunk_size = 64) {
+  assert(chunk_size > 0);
+
+  // Each chunk builds its own paths, which are moved into place at the end,
+  // so no placeholder path is ever built.
+  const size_t chunk_count = (settings.size() + chunk_size - 1) / chunk_size;
+  std::vector<std::vector<path>> chunk_results(chunk_count);
+  std::vector<dyn_prog_table> tables(pool ? pool->size() + 1 : 1);
+  auto solve_chunk = [&settings, &chunk_results, &tables, pool, chunk_size](size_t chunk) {
+    auto& table = tables[pool ? pool->worker_index() : 0];
+    auto& paths = chunk_results[chunk];
+    size_t first = chunk * chunk_size,
+           last = std::min(settings.size(), first + chunk_size);
+    paths.reserve(last - first);
+    for (size_t i = first; i < last; ++i) {
+      paths.push_back(greedy_gnomes_dyn_prog(settings[i], table));
+    }
+  };
+
+  for (size_t chunk = 0; chunk < chunk_count; ++chunk) {
+    if (pool) {
+      pool->submit([&solve_chunk, chunk]() { solve_chunk(chunk); });
+    } else {
+      solve_chunk(chunk);
+    }
+  }
+  if (pool) {
+    pool->wait();
+  }
+
+  std::vector<path> results;
+  results.reserve(settings.size());
+  for (auto& paths : chunk_results) {
+    for (auto& p : paths) {
+      results.push_back(std::move(p));
+    }
+  }
+  return results;
+}
+
+// Number of same-sized grids scored together by
+// greedy_gnomes_dyn_prog_score_batch.
+const size_t BATCH_LANES = 8;
+
+// Score BATCH_LANES grids of identical dimensions at once, writing one result
+// per grid to results. The grids' cells are interleaved structure-of-arrays
+// style, so scores[j * BATCH_LANES + l] holds column j of grid l, and the
+// innermost loops run over the lanes with no branches, which compilers turn
+// into vector instructions. scores is scratch space; it is only reallocated
+// when it holds fewer than columns*BATCH_LANES scores.
+void score_lanes(const grid* const* lanes, gold_score* results,
+                 std::vector<int32_t>& scores) {
+  const coordinate r = lanes[0]->rows(),
+                   c = lanes[0]->columns();
+  const int32_t unreachable = WAVEFRONT_UNREACHABLE;
+
+  scores.assign(c * BATCH_LANES, unreachable);
+  int32_t best[BATCH_LANES], left[BATCH_LANES],
+          gold[BATCH_LANES], rock[BATCH_LANES];
+  coordinate best_row[BATCH_LANES], best_column[BATCH_LANES];
+  const row_word* gold_rows[BATCH_LANES];
+  const row_word* rock_rows[BATCH_LANES];
+  for (size_t l = 0; l < BATCH_LANES; ++l) {
+    assert(lanes[l]->rows() == r && lanes[l]->columns() == c);
+    best[l] = 0;
+    best_row[l] = best_column[l] = 0;
+  }
+
+  for (coordinate i = 0; i < r; ++i) {
+    for (size_t l = 0; l < BATCH_LANES; ++l) {
+      gold_rows[l] = lanes[l]->gold_row(i);
+      rock_rows[l] = lanes[l]->rock_row(i);
+      left[l] = unreachable;
+    }
+
+    for (coordinate j = 0; j < c; ++j) {
+      const coordinate w = j / CELLS_PER_WORD,
+                       b = j % CELLS_PER_WORD;
+      for (size_t l = 0; l < BATCH_LANES; ++l) {
+        gold[l] = (gold_rows[l][w] >> b) & 1;
+        rock[l] = (rock_rows[l][w] >> b) & 1;
+      }
+
+      int32_t* cell = &scores[j * BATCH_LANES];
+      const bool start = (i == 0 && j == 0);
+      for (size_t l = 0; l < BATCH_LANES; ++l) {
+        int32_t from = start ? 0 : std::max(cell[l], left[l]);
+        int32_t score = (rock[l] || from == unreachable) ? unreachable
+                                                         : from + gold[l];
+        cell[l] = left[l] = score;
+
+        bool better = score > best[l];
+        best[l] = better ? score : best[l];
+        best_row[l] = better ? i : best_row[l];
+        best_column[l] = better ? j : best_column[l];
+      }
+    }
+  }
+
+  for (size_t l = 0; l < BATCH_LANES; ++l) {
+    results[l].total_gold = best[l];
+    results[l].final_row = best_row[l];
+    results[l].final_column = best_column[l];
+  }
+}
+
+// Compute only the total gold of an optimal path, and where it ends, for
+// every grid in settings, returning the results in the same order.
+//
+// Grids with the same dimensions are grouped, and each group is scored
+// BATCH_LANES grids at a time by score_lanes, one grid per vector lane; a
+// short final group is padded by repeating a grid. With a pool, groups of
+// lanes run on its workers. Each worker, and the calling thread, has one
+// scratch buffer for the whole batch, sized up front for the widest grid.
+// Each result equals what greedy_gnomes_dyn_prog_score returns.
+std::vector<gold_score> greedy_gnomes_dyn_prog_score_batch(const std::vector<grid>& settings,
+                                                           ThreadPool* pool = nullptr) {
+  // Stable-sort grid indices by dimensions, so same-sized grids are adjacent.
+  std::vector<size_t> order(settings.size());
+  for (size_t i = 0; i < order.size(); ++i) {
+    order[i] = i;
+  }
+  std::stable_sort(order.begin(), order.end(), [&settings](size_t a, size_t b) {
+      auto& x = settings[a];
+      auto& y = settings[b];
+      return (x.rows() < y.rows()) ||
+             (x.rows() == y.rows() && x.columns() < y.columns());
+    });
+
+  std::vector<gold_score> results(settings.size());
+
+  coordinate widest = 0;
+  for (auto& setting : settings) {
+    widest = std::max(widest, setting.columns());
+  }
+  std::vector<std::vector<int32_t>> scratch(pool ? pool->size() + 1 : 1);
+  for (auto& scores : scratch) {
+    scores.reserve(widest * BATCH_LANES);
+  }
+
+  auto solve_lanes = [&settings, &order, &results, &scratch, pool](size_t first,
+                                                                   size_t last) {
+    const grid* lanes[BATCH_LANES];
+    gold_score lane_results[BATCH_LANES];
+    for (size_t l = 0; l < BATCH_LANES; ++l) {
+      lanes[l] = &settings[order[std::min(first + l, last - 1)]];
+    }
+    score_lanes(lanes, lane_results, scratch[pool ? pool->worker_index() : 0]);
+    for (size_t k = first; k < last; ++k) {
+      results[order[k]] = lane_results[k - first];
+    }
+  };
+
+  size_t first = 0;
+  while (first < order.size()) {
+    auto& shape = settings[order[first]];
+    size_t last = first + 1;
+    while (last < order.size() && last - first < BATCH_LANES &&
+           settings[order[last]].rows() == shape.rows() &&
+           settings[order[last]].columns() == shape.columns()) {
+      ++last;
+    }
+
+    if (pool) {
+      pool->submit([&solve_lanes, first, last]() { solve_lanes(first, last); });
+    } else {
+      solve_lanes(first, last);
+    }
+    first = last;
+  }
+  if (pool) {
+    pool->wait();
+  }
+
+  return results;
+}
+
+}
@@ -0,0 +1,193 @@
+///////////////////////////////////////////////////////////////////////////////
+// gnomes_simd.hpp
+//
+// Vectorized dynamic programming for the greedy gnomes problem.
+//
+// Cells on one anti-diagonal (row+column = k) depend only on cells of the
+// previous anti-diagonal, so a whole diagonal can be computed with vector
+// instructions. SSE4.1 and AVX2 kernels are compiled with per-function target
+// attributes and chosen at run time, so the program still runs on machines
+// without them; other compilers and architectures get the scalar kernel.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+#include "gnomes_algs.hpp"
+
+#if (defined(__GNUC__) || defined(__clang__)) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define GNOMES_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+namespace gnomes {
+
+// Instruction set used by a wavefront kernel.
+enum simd_level { SIMD_SCALAR, SIMD_SSE41, SIMD_AVX2 };
+
+// Score held by the wavefront kernels for a cell no path can reach. It is far
+// enough from the int32_t limits that adding gold can never overflow.
+const int32_t WAVEFRONT_UNREACHABLE = INT32_MIN / 2;
+
+// Return true if this machine can run kernels for the given level.
+bool is_simd_level_supported(simd_level level) {
+  switch (level) {
+  case SIMD_SCALAR:
+    return true;
+#ifdef GNOMES_X86_SIMD
+  case SIMD_SSE41:
+    return __builtin_cpu_supports("sse4.1");
+  case SIMD_AVX2:
+    return __builtin_cpu_supports("avx2");
+#endif
+  default:
+    return false;
+  }
+}
+
+// Return the widest level this machine supports.
+simd_level best_simd_level() {
+  if (is_simd_level_supported(SIMD_AVX2)) {
+    return SIMD_AVX2;
+  } else if (is_simd_level_supported(SIMD_SSE41)) {
+    return SIMD_SSE41;
+  } else {
+    return SIMD_SCALAR;
+  }
+}
+
+// Compute count scores of one anti-diagonal. For each t, previous[t] and
+// previous[t + 1] are the scores of the cells above and to the left of cell t,
+// gold[t] is 1 for a gold cell and 0 otherwise, rock[t] is -1 for a rock cell
+// and 0 otherwise, and the result goes to current[t].
+void wavefront_kernel_scalar(const int32_t* previous, const int32_t* gold,
+                             const int32_t* rock, int32_t* current,
+                             size_t count) {
+  for (size_t t = 0; t < count; ++t) {
+    int32_t best = std::max(previous[t], previous[t + 1]);
+    current[t] = (rock[t] || best == WAVEFRONT_UNREACHABLE)
+                 ? WAVEFRONT_UNREACHABLE
+                 : best + gold[t];
+  }
+}
+
+#ifdef GNOMES_X86_SIMD
+
+__attribute__((target("sse4.1")))
+void wavefront_kernel_sse41(const int32_t* previous, const int32_t* gold,
+                            const int32_t* rock, int32_t* current,
+                            size_t count) {
+  const __m128i unreachable = _mm_set1_epi32(WAVEFRONT_UNREACHABLE);
+  size_t t = 0;
+  for (; t + 4 <= count; t += 4) {
+    auto above = _mm_loadu_si128((const __m128i*)(previous + t));
+    auto left = _mm_loadu_si128((const __m128i*)(previous + t + 1));
+    auto best = _mm_max_epi32(above, left);
+    auto blocked = _mm_or_si128(_mm_loadu_si128((const __m128i*)(rock + t)),
+                                _mm_cmpeq_epi32(best, unreachable));
+    auto score = _mm_add_epi32(best, _mm_loadu_si128((const __m128i*)(gold + t)));
+    _mm_storeu_si128((__m128i*)(current + t),
+                     _mm_blendv_epi8(score, unreachable, blocked));
+  }
+  wavefront_kernel_scalar(previous + t, gold + t, rock + t, current + t,
+                          count - t);
+}
+
+__attribute__((target("avx2")))
+void wavefront_kernel_avx2(const int32_t* previous, const int32_t* gold,
+                           const int32_t* rock, int32_t* current,
+                           size_t count) {
+  const __m256i unreachable = _mm256_set1_epi32(WAVEFRONT_UNREACHABLE);
+  size_t t = 0;
+  for (; t + 8 <= count; t += 8) {
+    auto above = _mm256_loadu_si256((const __m256i*)(previous + t));
+    auto left = _mm256_loadu_si256((const __m256i*)(previous + t + 1));
+    auto best = _mm256_max_epi32(above, left);
+    auto blocked = _mm256_or_si256(_mm256_loadu_si256((const __m256i*)(rock + t)),
+                                   _mm256_cmpeq_epi32(best, unreachable));
+    auto score = _mm256_add_epi32(best, _mm256_loadu_si256((const __m256i*)(gold + t)));
+    _mm256_storeu_si256((__m256i*)(current + t),
+                        _mm256_blendv_epi8(score, unreachable, blocked));
+  }
+  wavefront_kernel_scalar(previous + t, gold + t, rock + t, current + t,
+                          count - t);
+}
+
+#endif
+
+// Compute only the total gold of an optimal path, and where it ends, for the
+// given grid, one anti-diagonal at a time using the given instruction set,
+// which must be supported.
+//
+// The result is identical to greedy_gnomes_dyn_prog_score, including which
+// end cell is reported when several tie. Memory use is O(rows).
+//
+// The grid must be non-empty, and rows+columns must be less than 2^30.
+gold_score greedy_gnomes_dyn_prog_score_wavefront(const grid& setting,
+                                                  simd_level level = best_simd_level()) {
+  assert(setting.rows() > 0);
+  assert(setting.columns() > 0);
+  assert(is_simd_level_supported(level));
+
+  auto kernel = wavefront_kernel_scalar;
+#ifdef GNOMES_X86_SIMD
+  if (level == SIMD_AVX2) {
+    kernel = wavefront_kernel_avx2;
+  } else if (level == SIMD_SSE41) {
+    kernel = wavefront_kernel_sse41;
+  }
+#endif
+
+  const coordinate r = setting.rows(),
+                   c = setting.columns();
+
+  // Diagonal buffers are indexed by row + 1, so index 0 stands for the
+  // nonexistent row above row 0 and always stays unreachable.
+  std::vector<int32_t> previous(r + 2, WAVEFRONT_UNREACHABLE),
+                       current(r + 2, WAVEFRONT_UNREACHABLE),
+                       gold(r), rock(r);
+  previous[1] = 0;
+
+  gold_score best = { 0, 0, 0 };
+  for (coordinate k = 1; k + 1 < r + c; ++k) {
+    const coordinate first = (k >= c) ? (k - c + 1) : 0,
+                     last = std::min(r - 1, k),
+                     count = last - first + 1;
+
+    // Gather the diagonal's cells into flat arrays for the kernel.
+    for (coordinate i = first; i <= last; ++i) {
+      coordinate j = k - i;
+      row_word word_bit = row_word(1) << (j % CELLS_PER_WORD);
+      gold[i - first] = (setting.gold_row(i)[j / CELLS_PER_WORD] & word_bit) ? 1 : 0;
+      rock[i - first] = (setting.rock_row(i)[j / CELLS_PER_WORD] & word_bit) ? -1 : 0;
+    }
+
+    // The row above first is outside this diagonal; clear whatever an older
+    // diagonal left there.
+    current[first] = WAVEFRONT_UNREACHABLE;
+    kernel(&previous[first], &gold[0], &rock[0], &current[first + 1], count);
+
+    for (coordinate i = first; i <= last; ++i) {
+      int32_t score = current[i + 1];
+      if (score > int32_t(best.total_gold) ||
+          (score == int32_t(best.total_gold) && score > 0 &&
+           (i < best.final_row ||
+            (i == best.final_row && k - i < best.final_column)))) {
+        best.total_gold = score;
+        best.final_row = i;
+        best.final_column = k - i;
+      }
+    }
+
+    std::swap(previous, current);
+  }
+
+  return best;
+}
+
+}
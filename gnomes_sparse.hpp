@@ -0,0 +1,131 @@
+///////////////////////////////////////////////////////////////////////////////
+// gnomes_sparse.hpp
+//
+// Solving greedy gnomes grids with little gold in time that depends on the
+// amount of gold rather than the grid's area.
+//
+// Without rocks, every cell is reachable and a path can go from one cell to
+// any cell below and to the right of it. So the gold a path collects is a
+// chain of gold cells, each no higher and no further left than the next, and
+// the best path follows the longest such chain. With the gold cells in
+// row-major order that is a longest non-decreasing subsequence of their
+// columns, which a Fenwick tree over the columns finds in O(g*log(columns))
+// time for g gold cells.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cassert>
+#include <vector>
+#include "gnomes_algs.hpp"
+
+namespace gnomes {
+
+// Greatest gold density, gold cells per cell, at which greedy_gnomes_auto
+// prefers greedy_gnomes_sparse for a grid without rocks.
+const double SPARSE_GOLD_MAX_DENSITY = 0.05;
+
+// Return the number of gold cells in the given grid.
+size_t gold_count(const grid& setting) {
+  const row_word* gold = setting.gold_row(0);
+  size_t count = 0;
+  for (size_t w = 0; w < setting.rows() * setting.words_per_row(); ++w) {
+    count += __builtin_popcountll(gold[w]);
+  }
+  return count;
+}
+
+// Return the gold cells of the given grid in row-major order. Takes time
+// proportional to the number of bitboard words plus the number of gold cells.
+std::vector<grid_cell> gold_cells(const grid& setting) {
+  std::vector<grid_cell> result;
+  result.reserve(gold_count(setting));
+  for (coordinate i = 0; i < setting.rows(); ++i) {
+    const row_word* gold = setting.gold_row(i);
+    for (coordinate w = 0; w < setting.words_per_row(); ++w) {
+      for (row_word bits = gold[w]; bits; bits &= bits - 1) {
+        result.push_back({ i, w * CELLS_PER_WORD + __builtin_ctzll(bits) });
+      }
+    }
+  }
+  return result;
+}
+
+// Solve the greedy gnomes problem for the given grid using only its list of
+// gold cells, when it has no rocks; a grid with rocks is passed on to
+// greedy_gnomes_dyn_prog instead.
+//
+// The path collects as much gold as greedy_gnomes_dyn_prog's, but may differ
+// from it when several paths tie: it ends on the last gold cell of the first
+// longest chain found, and between gold cells it moves down first and then
+// right. Without rocks this takes O(rows*columns/64 + g*log(columns) + rows +
+// columns) time for g gold cells. The path is stored in arena, or on the heap
+// if it is null.
+//
+// The grid must be non-empty.
+path greedy_gnomes_sparse(const grid& setting, path_arena* arena = nullptr) {
+  assert(setting.rows() > 0);
+  assert(setting.columns() > 0);
+
+  if (!is_rock_free(setting)) {
+    return greedy_gnomes_dyn_prog(setting, arena);
+  }
+
+  auto golds = gold_cells(setting);
+  if (golds.empty()) {
+    return path(setting, arena);
+  }
+
+  // tree holds, for prefixes of the columns, the longest chain ending in
+  // them so far and the index of its last gold cell; 1-based, as Fenwick
+  // trees are.
+  struct chain_end {
+    unsigned length;
+    size_t last;
+  };
+  std::vector<chain_end> tree(setting.columns() + 1, chain_end{ 0, 0 });
+  std::vector<size_t> previous(golds.size());
+  size_t best = 0;
+  unsigned best_length = 0;
+
+  for (size_t g = 0; g < golds.size(); ++g) {
+    chain_end before = { 0, 0 };
+    for (size_t k = golds[g].column + 1; k > 0; k &= k - 1) {
+      if (tree[k].length > before.length) {
+        before = tree[k];
+      }
+    }
+
+    chain_end here = { before.length + 1, g };
+    previous[g] = before.last;
+    for (size_t k = golds[g].column + 1; k <= setting.columns(); k += k & (0 - k)) {
+      if (here.length > tree[k].length) {
+        tree[k] = here;
+      }
+    }
+    if (here.length > best_length) {
+      best_length = here.length;
+      best = g;
+    }
+  }
+
+  // Walk back along the chain. Between two gold cells the path moves down
+  // and then right, so going backwards it moves left until it is in the
+  // column of the chain's previous cell, or of (0, 0), and then up. earlier
+  // counts the chain cells before the segment being walked, and from is the
+  // last of them.
+  unsigned earlier = best_length - 1;
+  size_t from = previous[best];
+  return path(setting, golds[best].row, golds[best].column, best_length,
+              [&](coordinate i, coordinate j) {
+                if (earlier > 0 && i == golds[from].row && j == golds[from].column) {
+                  --earlier;
+                  from = previous[from];
+                }
+                return j > ((earlier > 0) ? golds[from].column : 0);
+              },
+              arena);
+}
+
+}
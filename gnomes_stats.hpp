@@ -0,0 +1,94 @@
+///////////////////////////////////////////////////////////////////////////////
+// gnomes_stats.hpp
+//
+// Optional instrumentation for the greedy gnomes solvers.
+//
+// Solvers that support instrumentation take a statistics policy object as a
+// template parameter. Passing a solver_stats makes them count their work and
+// time their phases; passing a no_stats, which is what the plain overloads
+// do, compiles every counter and timer call down to nothing.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <chrono>
+#include <iostream>
+
+namespace gnomes {
+
+// Phases of a solve that can be timed separately.
+enum solver_phase {
+  PHASE_INIT,   // allocating and initializing tables or bounds
+  PHASE_FILL,   // filling tables, or searching
+  PHASE_POST,   // finding the best cell and rebuilding the path
+  PHASE_COUNT
+};
+
+// Statistics policy that records nothing.
+struct no_stats {
+  void count_cell_relaxed() { }
+  void count_candidate() { }
+  void count_path_copy() { }
+  void count_pruned() { }
+  void begin_phase(solver_phase) { }
+  void end_phase(solver_phase) { }
+};
+
+// Statistics policy that counts operations and times phases.
+class solver_stats {
+private:
+  std::chrono::steady_clock::time_point phase_start_[PHASE_COUNT];
+
+public:
+  // Cells whose dynamic programming value was computed.
+  unsigned long long cells_relaxed;
+  // Paths, complete or partial, considered as candidate solutions.
+  unsigned long long candidates_evaluated;
+  // Paths copied or newly built.
+  unsigned long long paths_copied;
+  // Search branches cut off without being explored.
+  unsigned long long branches_pruned;
+  // Seconds spent in each solver_phase.
+  double phase_seconds[PHASE_COUNT];
+
+  solver_stats() { reset(); }
+
+  // Clear all counters and timers.
+  void reset() {
+    cells_relaxed = candidates_evaluated = paths_copied = branches_pruned = 0;
+    for (auto& seconds : phase_seconds) {
+      seconds = 0;
+    }
+  }
+
+  void count_cell_relaxed() { ++cells_relaxed; }
+  void count_candidate() { ++candidates_evaluated; }
+  void count_path_copy() { ++paths_copied; }
+  void count_pruned() { ++branches_pruned; }
+
+  // Time spent between begin_phase and the matching end_phase is added to
+  // that phase's total.
+  void begin_phase(solver_phase phase) {
+    phase_start_[phase] = std::chrono::steady_clock::now();
+  }
+  void end_phase(solver_phase phase) {
+    std::chrono::duration<double> span =
+      std::chrono::steady_clock::now() - phase_start_[phase];
+    phase_seconds[phase] += span.count();
+  }
+
+  // Print all counters and timers on one line.
+  void print(std::ostream& out = std::cout) const {
+    out << "cells relaxed=" << cells_relaxed
+        << " candidates=" << candidates_evaluated
+        << " paths copied=" << paths_copied
+        << " pruned=" << branches_pruned
+        << " init=" << phase_seconds[PHASE_INIT] << "s"
+        << " fill=" << phase_seconds[PHASE_FILL] << "s"
+        << " post=" << phase_seconds[PHASE_POST] << "s"
+        << std::endl;
+  }
+};
+
+}
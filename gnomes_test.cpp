@@ -6,12 +6,41 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
 #include <random>
+#include <stdexcept>
+#include <type_traits>
 
 #include "rubrictest.hpp"
 
 #include "gnomes_types.hpp"
 #include "gnomes_algs.hpp"
+#include "gnomes_parallel.hpp"
+#include "gnomes_simd.hpp"
+#include "gnomes_io.hpp"
+#include "gnomes_incremental.hpp"
+#include "gnomes_top_k.hpp"
+#include "gnomes_weighted.hpp"
+#include "gnomes_fixed.hpp"
+#include "gnomes_sparse.hpp"
+#include "gnomes_auto.hpp"
+
+#if __cplusplus >= 201402L
+// A fixed-size solve evaluated at compile time.
+constexpr gnomes::fixed_grid<4, 4> fixed_fixture() {
+  gnomes::fixed_grid<4, 4> setting;
+  setting.set(0, 3, gnomes::CELL_GOLD);
+  setting.set(2, 2, gnomes::CELL_GOLD);
+  setting.set(3, 2, gnomes::CELL_GOLD);
+  setting.set(1, 1, gnomes::CELL_ROCK);
+  return setting;
+}
+static_assert(gnomes::fixed_dyn_prog(fixed_fixture()).total_gold == 2,
+              "fixed_dyn_prog should run at compile time");
+#endif
 
 int main() {
 
@@ -79,6 +108,26 @@ int main() {
          TEST_EQUAL("correct", maze_solution, greedy_gnomes_exhaustive(maze));
 		   });
 
+  rubric.criterion("exhaustive search - ties", 1,
+		   [&]() {
+         // Depth-first order, down before right, and no trailing steps after
+         // the last gold cell collected.
+         gnomes::grid corner(2, 2);
+         corner.set(0, 1, gnomes::CELL_GOLD);
+         auto output = greedy_gnomes_exhaustive(corner);
+         TEST_EQUAL("ends on gold row", 0, output.final_row());
+         TEST_EQUAL("ends on gold column", 1, output.final_column());
+         TEST_EQUAL("no trailing steps", 2, output.steps().size());
+
+         corner.set(1, 0, gnomes::CELL_GOLD);
+         output = greedy_gnomes_exhaustive(corner);
+         TEST_EQUAL("down first row", 1, output.final_row());
+         TEST_EQUAL("down first column", 0, output.final_column());
+
+         output = greedy_gnomes_exhaustive(gnomes::grid(3, 3));
+         TEST_EQUAL("no gold stays at the start", 1, output.steps().size());
+		   });
+
   rubric.criterion("dynamic programming - simple cases", 4,
 		   [&]() {
          TEST_EQUAL("empty2", empty2_solution, greedy_gnomes_dyn_prog(empty2));
@@ -128,5 +177,715 @@ int main() {
          }
 		   });
 
+  rubric.criterion("dynamic programming - score only", 1,
+		   [&]() {
+         auto maze_score = gnomes::greedy_gnomes_dyn_prog_score(maze);
+         TEST_EQUAL("maze gold", 1, maze_score.total_gold);
+         TEST_EQUAL("maze row", 3, maze_score.final_row);
+         TEST_EQUAL("maze column", 3, maze_score.final_column);
+
+         for (auto& setting : {small_random, medium_random, large_random}) {
+           auto expected = gnomes::greedy_gnomes_dyn_prog(setting);
+           auto output = gnomes::greedy_gnomes_dyn_prog_score(setting);
+           TEST_EQUAL("gold", expected.total_gold(), output.total_gold);
+           TEST_EQUAL("row", expected.final_row(), output.final_row);
+           TEST_EQUAL("column", expected.final_column(), output.final_column);
+         }
+		   });
+
+  rubric.criterion("dynamic programming - linear space", 1,
+		   [&]() {
+         TEST_EQUAL("empty4", empty4_solution, gnomes::greedy_gnomes_dyn_prog_linear_space(empty4));
+         TEST_EQUAL("horizontal", horizontal_solution, gnomes::greedy_gnomes_dyn_prog_linear_space(horizontal));
+         TEST_EQUAL("vertical", vertical_solution, gnomes::greedy_gnomes_dyn_prog_linear_space(vertical));
+         TEST_EQUAL("maze", maze_solution, gnomes::greedy_gnomes_dyn_prog_linear_space(maze));
+         TEST_EQUAL("all_gold", 6, gnomes::greedy_gnomes_dyn_prog_linear_space(all_gold).total_gold());
+
+         std::mt19937 gen(20181130);
+         for (unsigned i = 0; i < 50; ++i) {
+           gnomes::grid setting = gnomes::grid::random(30, 40, 240, 120, gen);
+           TEST_EQUAL("random grid " + std::to_string(i),
+                      gnomes::greedy_gnomes_dyn_prog(setting).total_gold(),
+                      gnomes::greedy_gnomes_dyn_prog_linear_space(setting).total_gold());
+         }
+		   });
+
+  rubric.criterion("grid - bitboard storage", 1,
+		   [&]() {
+         gnomes::grid wide(3, 130);
+         wide.set(1, 64, gnomes::CELL_GOLD);
+         wide.set(2, 129, gnomes::CELL_ROCK);
+         wide.set(2, 129, gnomes::CELL_GOLD);
+         wide.set(0, 63, gnomes::CELL_ROCK);
+         TEST_EQUAL("words per row", 3, wide.words_per_row());
+         TEST_EQUAL("gold word", 1, wide.gold_row(1)[1]);
+         TEST_EQUAL("overwritten rock", 0, wide.rock_row(2)[2]);
+         TEST_EQUAL("overwriting gold", 2, wide.gold_row(2)[2]);
+         TEST_EQUAL("rock word", uint64_t(1) << 63, wide.rock_row(0)[0]);
+         TEST_EQUAL("get gold", gnomes::CELL_GOLD, wide.get(2, 129));
+         TEST_EQUAL("get rock", gnomes::CELL_ROCK, wide.get(0, 63));
+         TEST_EQUAL("get earth", gnomes::CELL_EARTH, wide.get(1, 63));
+         TEST_FALSE("may not step on rock", wide.may_step(0, 63));
+         TEST_FALSE("may not step off grid", wide.may_step(0, 130));
+		   });
+
+  rubric.criterion("path - packed steps", 1,
+		   [&]() {
+         gnomes::grid wide(2, 100);
+         wide.set(1, 99, gnomes::CELL_GOLD);
+         std::vector<gnomes::step_direction> moves(99, R);
+         moves.push_back(D);
+         gnomes::path long_path(wide, moves), copy = long_path;
+         TEST_EQUAL("step count", 101, copy.step_count());
+         TEST_EQUAL("start", gnomes::STEP_DIRECTION_START, copy.direction(0));
+         TEST_EQUAL("step 70", R, copy.direction(70));
+         TEST_EQUAL("last step", D, copy.last_step().direction());
+         TEST_EQUAL("gold", 1, copy.total_gold());
+         TEST_EQUAL("final row", 1, copy.final_row());
+         TEST_EQUAL("final column", 99, copy.final_column());
+         TEST_EQUAL("copy", long_path, copy);
+         TEST_FALSE("different path", gnomes::path(wide, {D}) == copy);
+		   });
+
+  rubric.criterion("exhaustive search - branch and bound", 1,
+		   [&]() {
+         TEST_EQUAL("maze", maze_solution, gnomes::greedy_gnomes_exhaustive_bounded(maze));
+         TEST_EQUAL("all_gold", 6, gnomes::greedy_gnomes_exhaustive_bounded(all_gold).total_gold());
+
+         std::mt19937 gen(20181130);
+         for (gnomes::coordinate columns = 1; columns <= 12; ++columns) {
+           auto area = 5 * columns;
+           gnomes::grid setting = gnomes::grid::random(5, columns, area / 5, area / 10, gen);
+           gnomes::solver_stats stats, bounded_stats;
+           auto output = gnomes::greedy_gnomes_exhaustive_bounded(setting, bounded_stats);
+           auto expected = gnomes::greedy_gnomes_exhaustive(setting, stats);
+           TEST_TRUE("same path", expected == output && output == expected);
+           TEST_GT("visited", bounded_stats.candidates_evaluated, 0);
+           TEST_LE("visited fewer", bounded_stats.candidates_evaluated, stats.candidates_evaluated);
+           TEST_LE("pruned", bounded_stats.branches_pruned, bounded_stats.candidates_evaluated);
+           TEST_EQUAL("nothing pruned", 0, stats.branches_pruned);
+         }
+		   });
+
+  rubric.criterion("exhaustive search - parallel", 1,
+		   [&]() {
+         ThreadPool pool(4);
+         TEST_EQUAL("default prefix", 5, gnomes::exhaustive_prefix_steps(pool.size()));
+         TEST_EQUAL("empty2", empty2_solution, gnomes::greedy_gnomes_exhaustive_parallel(empty2, pool));
+         TEST_EQUAL("maze", maze_solution, gnomes::greedy_gnomes_exhaustive_parallel(maze, pool));
+
+         std::mt19937 gen(20181130);
+         for (gnomes::coordinate columns = 1; columns <= 12; ++columns) {
+           auto area = 5 * columns;
+           gnomes::grid setting = gnomes::grid::random(5, columns, area / 5, area / 10, gen);
+           auto expected = gnomes::greedy_gnomes_exhaustive(setting);
+           for (size_t prefix_steps : {0, 1, 3, 20}) {
+             auto output = gnomes::greedy_gnomes_exhaustive_parallel(setting, pool, prefix_steps);
+             TEST_TRUE("same path", expected == output && output == expected);
+           }
+           auto output = gnomes::greedy_gnomes_exhaustive_parallel(setting, pool);
+           TEST_TRUE("same path, default prefix", expected == output && output == expected);
+         }
+		   });
+
+  rubric.criterion("exhaustive search - meet in the middle", 1,
+		   [&]() {
+         TEST_EQUAL("empty2", empty2_solution, gnomes::greedy_gnomes_exhaustive_meet_in_middle(empty2));
+         TEST_EQUAL("maze", maze_solution, gnomes::greedy_gnomes_exhaustive_meet_in_middle(maze));
+         TEST_EQUAL("all_gold", 6, gnomes::greedy_gnomes_exhaustive_meet_in_middle(all_gold).total_gold());
+         gnomes::grid single(1, 1);
+         TEST_EQUAL("single", 1, gnomes::greedy_gnomes_exhaustive_meet_in_middle(single).step_count());
+
+         std::mt19937 gen(20181130);
+         for (gnomes::coordinate columns = 1; columns <= 12; ++columns) {
+           auto area = 5 * columns;
+           gnomes::grid setting = gnomes::grid::random(5, columns, area / 5, area / 10, gen);
+           TEST_EQUAL("random grid with " + std::to_string(columns) + " columns",
+                      gnomes::greedy_gnomes_exhaustive(setting).total_gold(),
+                      gnomes::greedy_gnomes_exhaustive_meet_in_middle(setting).total_gold());
+         }
+
+         // Longer than the plain exhaustive search allows.
+         gnomes::grid tall = gnomes::grid::random(60, 6, 72, 36, gen);
+         TEST_EQUAL("tall grid",
+                    gnomes::greedy_gnomes_dyn_prog(tall).total_gold(),
+                    gnomes::greedy_gnomes_exhaustive_meet_in_middle(tall).total_gold());
+		   });
+
+  rubric.criterion("dynamic programming - vectorized wavefront", 1,
+		   [&]() {
+         std::mt19937 gen(20181130);
+         std::vector<gnomes::grid> settings = {empty2, horizontal, vertical, all_gold, maze,
+                                               small_random, medium_random, large_random,
+                                               gnomes::grid(1, 40), gnomes::grid(40, 1)};
+         for (unsigned i = 0; i < 20; ++i) {
+           settings.push_back(gnomes::grid::random(37, 53, 390, 190, gen));
+         }
+
+         for (auto level : {gnomes::SIMD_SCALAR, gnomes::SIMD_SSE41, gnomes::SIMD_AVX2}) {
+           if (!gnomes::is_simd_level_supported(level)) {
+             continue;
+           }
+           for (auto& setting : settings) {
+             auto expected = gnomes::greedy_gnomes_dyn_prog_score(setting);
+             auto output = gnomes::greedy_gnomes_dyn_prog_score_wavefront(setting, level);
+             TEST_EQUAL("gold", expected.total_gold, output.total_gold);
+             TEST_EQUAL("row", expected.final_row, output.final_row);
+             TEST_EQUAL("column", expected.final_column, output.final_column);
+           }
+         }
+		   });
+
+  rubric.criterion("dynamic programming - parallel tiles", 1,
+		   [&]() {
+         ThreadPool pool(4);
+         std::mt19937 gen(20181130);
+         std::vector<gnomes::grid> settings = {empty2, maze, small_random, medium_random,
+                                               large_random, gnomes::grid(1, 40)};
+         for (unsigned i = 0; i < 10; ++i) {
+           settings.push_back(gnomes::grid::random(97, 61, 1180, 590, gen));
+         }
+
+         for (auto& setting : settings) {
+           auto expected = gnomes::greedy_gnomes_dyn_prog_score(setting);
+           auto expected_path = gnomes::greedy_gnomes_dyn_prog(setting);
+           for (gnomes::coordinate tile : {1, 7, 32, 256}) {
+             auto output = gnomes::greedy_gnomes_dyn_prog_score_parallel(setting, pool, tile, tile + 3);
+             TEST_EQUAL("gold", expected.total_gold, output.total_gold);
+             TEST_EQUAL("row", expected.final_row, output.final_row);
+             TEST_EQUAL("column", expected.final_column, output.final_column);
+
+             auto output_path = gnomes::greedy_gnomes_dyn_prog_parallel(setting, pool, tile, tile + 3);
+             TEST_TRUE("path", expected_path == output_path && output_path == expected_path);
+           }
+           auto auto_output = gnomes::greedy_gnomes_dyn_prog_score_parallel(setting, pool);
+           TEST_EQUAL("auto tiles gold", expected.total_gold, auto_output.total_gold);
+           auto auto_path = gnomes::greedy_gnomes_dyn_prog_parallel(setting, pool);
+           TEST_TRUE("auto tiles path", expected_path == auto_path && auto_path == expected_path);
+         }
+
+         auto shape = gnomes::wavefront_tile_shape(2000, 100000, 16);
+         TEST_EQUAL("tile rows", 125, shape.rows);
+         TEST_EQUAL("tile columns", gnomes::WAVEFRONT_MAX_TILE_SIDE, shape.columns);
+         shape = gnomes::wavefront_tile_shape(40, 40, 8);
+         TEST_EQUAL("small tiles", gnomes::WAVEFRONT_MIN_TILE_SIDE, shape.rows);
+		   });
+
+  rubric.criterion("dynamic programming - batches", 1,
+		   [&]() {
+         std::mt19937 gen(20181130);
+         std::vector<gnomes::grid> settings = {maze, small_random, empty2};
+         for (unsigned i = 0; i < 30; ++i) {
+           settings.push_back(gnomes::grid::random(10 + i % 3, 12, 24, 12, gen));
+         }
+         settings.push_back(large_random);
+
+         ThreadPool pool(3);
+         for (auto batch_pool : {(ThreadPool*) nullptr, &pool}) {
+           auto paths = gnomes::greedy_gnomes_dyn_prog_batch(settings, batch_pool, 4);
+           auto scores = gnomes::greedy_gnomes_dyn_prog_score_batch(settings, batch_pool);
+           TEST_EQUAL("path count", settings.size(), paths.size());
+           TEST_EQUAL("score count", settings.size(), scores.size());
+           for (size_t i = 0; i < settings.size(); ++i) {
+             auto expected = gnomes::greedy_gnomes_dyn_prog(settings[i]);
+             TEST_TRUE("path " + std::to_string(i), expected == paths[i] && paths[i] == expected);
+             TEST_EQUAL("gold " + std::to_string(i), expected.total_gold(), scores[i].total_gold);
+             TEST_EQUAL("row " + std::to_string(i), expected.final_row(), scores[i].final_row);
+             TEST_EQUAL("column " + std::to_string(i), expected.final_column(), scores[i].final_column);
+           }
+         }
+		   });
+
+  rubric.criterion("grid files - binary format", 1,
+		   [&]() {
+         const std::string filename = "gnomes_test_grid.bin";
+         for (auto& setting : {maze, large_random, gnomes::grid(3, 130)}) {
+           gnomes::write_grid_binary(setting, filename);
+           gnomes::grid mapped = gnomes::map_grid_binary(filename);
+           TEST_TRUE("view", mapped.is_view());
+           TEST_EQUAL("rows", setting.rows(), mapped.rows());
+           TEST_EQUAL("columns", setting.columns(), mapped.columns());
+           TEST_TRUE("cells", setting.printable() == mapped.printable());
+
+           gnomes::grid copy = mapped;
+           TEST_EQUAL("solve view",
+                      gnomes::greedy_gnomes_dyn_prog(setting).total_gold(),
+                      gnomes::greedy_gnomes_dyn_prog(copy).total_gold());
+         }
+
+         {
+           std::ofstream truncated(filename, std::ios::binary | std::ios::trunc);
+           truncated << "GNOMGRID";
+         }
+         bool threw = false;
+         try {
+           gnomes::map_grid_binary(filename);
+         } catch (std::runtime_error&) {
+           threw = true;
+         }
+         TEST_TRUE("truncated file rejected", threw);
+
+         {
+           // 2 * rows * 8 bytes of boards wraps around to just 16 bytes.
+           gnomes::grid_file_header header;
+           std::memcpy(header.magic, gnomes::GRID_FILE_MAGIC, sizeof(header.magic));
+           header.version = gnomes::GRID_FILE_VERSION;
+           header.encoding = gnomes::GRID_ENCODING_BITBOARD;
+           header.rows = (uint64_t(1) << 60) + 1;
+           header.columns = 64;
+           const uint64_t boards[2] = { 0, 0 };
+           std::ofstream wrapped(filename, std::ios::binary | std::ios::trunc);
+           wrapped.write(reinterpret_cast<const char*>(&header), sizeof(header));
+           wrapped.write(reinterpret_cast<const char*>(boards), sizeof(boards));
+         }
+         threw = false;
+         try {
+           gnomes::map_grid_binary(filename);
+         } catch (std::runtime_error&) {
+           threw = true;
+         }
+         std::remove(filename.c_str());
+         TEST_TRUE("overflowing size rejected", threw);
+		   });
+
+  rubric.criterion("grid files - text format", 1,
+		   [&]() {
+         for (auto& setting : {maze, small_random, large_random}) {
+           std::string text;
+           for (auto& line : setting.printable()) {
+             text += line + "\n";
+           }
+           auto parsed = gnomes::parse_grid_text(text.data(), text.size());
+           TEST_TRUE("round trip", setting.printable() == parsed.printable());
+         }
+
+         std::string windows = "..g\r\nX.G\r\n+.X";
+         auto parsed = gnomes::parse_grid_text(windows.data(), windows.size());
+         TEST_EQUAL("rows", 3, parsed.rows());
+         TEST_EQUAL("columns", 3, parsed.columns());
+         TEST_EQUAL("gold", gnomes::CELL_GOLD, parsed.get(1, 2));
+         TEST_EQUAL("path mark", gnomes::CELL_EARTH, parsed.get(2, 0));
+
+         for (std::string bad : {"...\n..\n", "..\n.?\n", "g.\n..\n", ""}) {
+           bool threw = false;
+           try {
+             gnomes::parse_grid_text(bad.data(), bad.size());
+           } catch (std::runtime_error&) {
+             threw = true;
+           }
+           TEST_TRUE("rejected", threw);
+         }
+
+         const std::string filename = "gnomes_test_grid.txt";
+         {
+           std::ofstream out(filename);
+           for (auto& line : maze.printable()) {
+             out << line << std::endl;
+           }
+         }
+         auto loaded = gnomes::load_grid_text(filename);
+         std::remove(filename.c_str());
+         TEST_TRUE("file", maze.printable() == loaded.printable());
+		   });
+
+  rubric.criterion("instrumentation", 1,
+		   [&]() {
+         gnomes::solver_stats stats;
+         auto output = gnomes::greedy_gnomes_dyn_prog(medium_random, stats);
+         TEST_EQUAL("same path", gnomes::greedy_gnomes_dyn_prog(medium_random), output);
+         size_t live_cells = 0;
+         for (auto& span : gnomes::reachable_spans(medium_random)) {
+           live_cells += span.is_empty() ? 0 : (span.last - span.first + 1);
+         }
+         TEST_EQUAL("cells relaxed", live_cells, stats.cells_relaxed);
+         TEST_EQUAL("paths built", 1, stats.paths_copied);
+         TEST_GE("fill time", stats.phase_seconds[gnomes::PHASE_FILL], 0);
+
+         stats.reset();
+         gnomes::greedy_gnomes_exhaustive(empty2, stats);
+         TEST_EQUAL("candidates", 5, stats.candidates_evaluated);
+         TEST_EQUAL("cells relaxed", 0, stats.cells_relaxed);
+		   });
+
+  rubric.criterion("path arena", 1,
+		   [&]() {
+         gnomes::path_arena arena(256);
+         auto exhaustive = gnomes::greedy_gnomes_exhaustive(small_random, &arena);
+         TEST_EQUAL("exhaustive", gnomes::greedy_gnomes_exhaustive(small_random), exhaustive);
+         TEST_TRUE("stored in arena", exhaustive.arena() == &arena);
+         auto middle = gnomes::greedy_gnomes_exhaustive_meet_in_middle(medium_random, &arena);
+         TEST_EQUAL("meet in the middle", gnomes::greedy_gnomes_exhaustive_meet_in_middle(medium_random),
+                    middle);
+         auto copy = middle;
+         TEST_TRUE("copy in arena", copy.arena() == &arena);
+
+         gnomes::path kept(middle, nullptr);
+         TEST_TRUE("kept on heap", kept.arena() == nullptr);
+         const size_t capacity = arena.capacity();
+         TEST_GE("capacity", capacity, 256);
+
+         arena.reset();
+         auto dyn_prog = gnomes::greedy_gnomes_dyn_prog(medium_random, &arena);
+         TEST_EQUAL("dyn prog", gnomes::greedy_gnomes_dyn_prog(medium_random), dyn_prog);
+         TEST_EQUAL("blocks reused", capacity, arena.capacity());
+         TEST_EQUAL("kept path", middle.total_gold(), kept.total_gold());
+		   });
+
+  rubric.criterion("dynamic programming - incremental", 1,
+		   [&]() {
+         std::mt19937 gen(20181201);
+         auto setting = gnomes::grid::random(30, 40, 240, 120, gen);
+         gnomes::incremental_dyn_prog solver(setting);
+         TEST_EQUAL("initial", gnomes::greedy_gnomes_dyn_prog(setting), solver.best_path());
+
+         std::uniform_int_distribution<gnomes::coordinate> row(0, 29), column(0, 39);
+         std::uniform_int_distribution<int> kind(0, 2), count(1, 5);
+         bool all_match = true;
+         for (unsigned round = 0; round < 200; ++round) {
+           std::vector<gnomes::cell_edit> edits;
+           for (int k = count(gen); k > 0; --k) {
+             gnomes::cell_edit e = { row(gen), column(gen), gnomes::cell_kind(kind(gen)) };
+             if (e.row != 0 || e.column != 0) {
+               edits.push_back(e);
+               setting.set(e.row, e.column, e.kind);
+             }
+           }
+           auto output = solver.apply(edits);
+           auto expected = gnomes::greedy_gnomes_dyn_prog(setting);
+           all_match = all_match && (expected == output) && (output == expected);
+         }
+         TEST_TRUE("after edits", all_match);
+
+         gnomes::dyn_prog_table table;
+         table.fill(setting);
+         bool same_table = true;
+         for (gnomes::coordinate i = 0; i < 30; ++i) {
+           for (gnomes::coordinate j = 0; j < 40; ++j) {
+             same_table = same_table && (table.gold(i, j) == solver.table().gold(i, j));
+           }
+         }
+         TEST_TRUE("same table", same_table);
+
+         gnomes::solver_stats stats;
+         solver.apply({{29, 39, gnomes::CELL_EARTH}}, stats);
+         TEST_EQUAL("corner edit", 1, stats.cells_relaxed);
+         stats.reset();
+         solver.apply({}, stats);
+         TEST_EQUAL("no edits", 0, stats.cells_relaxed);
+		   });
+
+  rubric.criterion("dynamic programming - path index", 1,
+		   [&]() {
+         gnomes::best_path_index index(maze);
+         auto best = gnomes::greedy_gnomes_dyn_prog(maze);
+         TEST_EQUAL("global best", best, index.path_to(best.final_row(), best.final_column()));
+         TEST_EQUAL("max gold", best.total_gold(),
+                    index.max_gold(best.final_row(), best.final_column()));
+         TEST_EQUAL("start", 0, index.max_gold(0, 0));
+
+         // Compare with solving a copy of the grid cut down to end at each cell.
+         bool all_match = true;
+         std::vector<gnomes::grid_cell> reachable;
+         for (gnomes::coordinate i = 0; i < maze.rows(); ++i) {
+           for (gnomes::coordinate j = 0; j < maze.columns(); ++j) {
+             if (maze.get(i, j) == gnomes::CELL_ROCK) {
+               all_match = all_match && !index.is_reachable(i, j) &&
+                           index.max_gold(i, j) == gnomes::UNREACHABLE;
+               continue;
+             }
+             gnomes::grid cut(i + 1, j + 1);
+             for (gnomes::coordinate y = 0; y <= i; ++y) {
+               for (gnomes::coordinate x = 0; x <= j; ++x) {
+                 cut.set(y, x, maze.get(y, x));
+               }
+             }
+             gnomes::dyn_prog_table table;
+             table.fill(cut);
+             all_match = all_match && (table.gold(i, j) == index.max_gold(i, j));
+             if (index.is_reachable(i, j)) {
+               reachable.push_back({i, j});
+               auto p = index.path_to(i, j);
+               std::vector<gnomes::step_direction> moves;
+               for (size_t k = 1; k < p.step_count(); ++k) {
+                 moves.push_back(p.direction(k));
+               }
+               gnomes::path walked(maze, moves);
+               all_match = all_match && walked.final_row() == i && walked.final_column() == j &&
+                           walked.total_gold() == index.max_gold(i, j) &&
+                           p.total_gold() == index.max_gold(i, j);
+             }
+           }
+         }
+         TEST_TRUE("every cell", all_match);
+
+         auto golds = index.max_gold(reachable);
+         auto paths = index.paths_to(reachable);
+         TEST_EQUAL("batch size", reachable.size(), paths.size());
+         bool batch_match = true;
+         for (size_t k = 0; k < reachable.size(); ++k) {
+           auto single = index.path_to(reachable[k].row, reachable[k].column);
+           batch_match = batch_match && (single == paths[k]) && (paths[k] == single) &&
+                         golds[k] == single.total_gold();
+         }
+         TEST_TRUE("batch", batch_match);
+		   });
+
+  rubric.criterion("dynamic programming - top k", 1,
+		   [&]() {
+         std::mt19937 gen(20181202);
+         std::vector<gnomes::grid> settings = {maze, all_gold, small_random};
+         for (unsigned i = 0; i < 5; ++i) {
+           settings.push_back(gnomes::grid::random(5, 6, 8, 5, gen));
+         }
+
+         bool golds_match = true, distinct = true, valid = true, first_match = true;
+         for (auto& setting : settings) {
+           // Gold of every valid path, best first.
+           std::vector<unsigned> all;
+           gnomes::path candidate(setting);
+           std::function<void()> visit = [&]() {
+             all.push_back(candidate.total_gold());
+             for (auto dir : {D, R}) {
+               if (candidate.is_step_valid(dir)) {
+                 candidate.add_step(dir);
+                 visit();
+                 candidate.pop_step();
+               }
+             }
+           };
+           visit();
+           std::sort(all.rbegin(), all.rend());
+
+           for (size_t k : {size_t(1), size_t(3), size_t(10), all.size() + 5}) {
+             auto paths = gnomes::greedy_gnomes_dyn_prog_top_k(setting, k);
+             golds_match = golds_match && paths.size() == std::min(k, all.size());
+             for (size_t t = 0; t < paths.size() && golds_match; ++t) {
+               golds_match = (paths[t].total_gold() == all[t]);
+
+               std::vector<gnomes::step_direction> moves;
+               for (size_t m = 1; m < paths[t].step_count(); ++m) {
+                 moves.push_back(paths[t].direction(m));
+               }
+               gnomes::path walked(setting, moves);
+               valid = valid && walked.total_gold() == paths[t].total_gold();
+
+               for (size_t u = 0; u < t; ++u) {
+                 distinct = distinct && !(paths[u] == paths[t] && paths[t] == paths[u]);
+               }
+             }
+             first_match = first_match && paths[0] == gnomes::greedy_gnomes_dyn_prog(setting) &&
+                           gnomes::greedy_gnomes_dyn_prog(setting) == paths[0];
+           }
+         }
+         TEST_TRUE("gold of the k best", golds_match);
+         TEST_TRUE("valid", valid);
+         TEST_TRUE("distinct", distinct);
+         TEST_TRUE("first is the dyn prog path", first_match);
+
+         auto once = gnomes::greedy_gnomes_dyn_prog_top_k(medium_random, 8),
+              again = gnomes::greedy_gnomes_dyn_prog_top_k(medium_random, 8);
+         bool deterministic = once.size() == again.size();
+         for (size_t t = 0; deterministic && t < once.size(); ++t) {
+           deterministic = once[t] == again[t] && again[t] == once[t];
+         }
+         TEST_TRUE("deterministic", deterministic);
+		   });
+
+  rubric.criterion("weighted cells", 1,
+		   [&]() {
+         TEST_TRUE("int8 scores", (std::is_same<gnomes::narrowest_score<1, 63>::type, int8_t>::value));
+         TEST_TRUE("int16 scores", (std::is_same<gnomes::narrowest_score<1, 64>::type, int16_t>::value));
+         TEST_TRUE("int32 scores", (std::is_same<gnomes::narrowest_score<255, 128>::type, int32_t>::value));
+         TEST_TRUE("int64 scores", (std::is_same<gnomes::narrowest_score<1, (1ull << 31)>::type, int64_t>::value));
+
+         // Ordinary grids give the same answers as the gold solvers.
+         bool same_as_gold = true;
+         for (auto* setting : {&maze, &all_gold, &small_random, &medium_random, &large_random}) {
+           auto weighted = gnomes::weighted_from(*setting);
+           auto expected = gnomes::greedy_gnomes_dyn_prog(*setting);
+           auto score = gnomes::weighted_dyn_prog_score_auto(weighted);
+           auto output = gnomes::weighted_dyn_prog_auto(weighted);
+           same_as_gold = same_as_gold &&
+                          score.total_value == expected.total_gold() &&
+                          score.final_row == expected.final_row() &&
+                          score.final_column == expected.final_column() &&
+                          output.step_count() == expected.step_count();
+           for (size_t k = 0; same_as_gold && k < expected.step_count(); ++k) {
+             same_as_gold = (output.direction(k) == expected.direction(k));
+           }
+         }
+         TEST_TRUE("same as gold", same_as_gold);
+
+         // Negative values, checked against every path.
+         std::mt19937 gen(20181203);
+         std::uniform_int_distribution<int> value(-5, 5), percent(0, 99);
+         bool all_match = true;
+         for (unsigned round = 0; round < 20; ++round) {
+           gnomes::weighted_grid<int16_t> setting(5, 6);
+           for (gnomes::coordinate i = 0; i < 5; ++i) {
+             for (gnomes::coordinate j = 0; j < 6; ++j) {
+               if ((i != 0 || j != 0) && percent(gen) < 15) {
+                 setting.set_rock(i, j);
+               } else {
+                 setting.set_value(i, j, value(gen));
+               }
+             }
+           }
+
+           int64_t best = 0;
+           std::function<void(gnomes::coordinate, gnomes::coordinate, int64_t)> visit =
+             [&](gnomes::coordinate i, gnomes::coordinate j, int64_t score) {
+               best = std::max(best, score);
+               if (i + 1 < 5 && !setting.is_rock(i + 1, j)) {
+                 visit(i + 1, j, score + setting.value(i + 1, j));
+               }
+               if (j + 1 < 6 && !setting.is_rock(i, j + 1)) {
+                 visit(i, j + 1, score + setting.value(i, j + 1));
+               }
+             };
+           visit(0, 0, 0);
+
+           auto output = gnomes::weighted_dyn_prog_auto(setting);
+           int64_t walked = 0;
+           gnomes::coordinate i = 0, j = 0;
+           for (size_t k = 1; k < output.step_count(); ++k) {
+             if (output.direction(k) == gnomes::STEP_DIRECTION_RIGHT) {
+               ++j;
+             } else {
+               ++i;
+             }
+             all_match = all_match && !setting.is_rock(i, j);
+             walked += setting.value(i, j);
+           }
+           auto narrow = gnomes::weighted_dyn_prog_score<int8_t>(setting);
+           auto wide = gnomes::weighted_dyn_prog_score<int64_t>(setting);
+           all_match = all_match && output.total_value() == best && walked == best &&
+                       i == output.final_row() && j == output.final_column() &&
+                       narrow.total_value == best && wide.total_value == best &&
+                       narrow.final_row == i && narrow.final_column == j &&
+                       wide.final_row == i && wide.final_column == j;
+         }
+         TEST_TRUE("negative values", all_match);
+		   });
+
+  rubric.criterion("dynamic programming - fixed size", 1,
+		   [&]() {
+         std::mt19937 gen(20181204);
+         bool all_match = true;
+         for (gnomes::coordinate n : {8, 16, 32, 12}) {
+           for (unsigned round = 0; round < 10; ++round) {
+             auto setting = gnomes::grid::random(n, n, n * n / 5, n * n / 10, gen);
+             auto expected = gnomes::greedy_gnomes_dyn_prog(setting),
+                  output = gnomes::greedy_gnomes_auto(setting);
+             all_match = all_match && expected == output && output == expected &&
+                         expected.total_gold() == output.total_gold();
+           }
+         }
+         TEST_TRUE("same as dyn prog", all_match);
+
+         auto fixed = gnomes::greedy_gnomes_fixed<4, 4>(maze);
+         TEST_EQUAL("maze", maze_solution, fixed);
+         TEST_EQUAL("maze gold", maze_solution.total_gold(), fixed.total_gold());
+
+         gnomes::fixed_grid<4, 4> copy(maze);
+         bool same_cells = true;
+         for (gnomes::coordinate i = 0; i < 4; ++i) {
+           for (gnomes::coordinate j = 0; j < 4; ++j) {
+             same_cells = same_cells && copy.get(i, j) == maze.get(i, j);
+           }
+         }
+         TEST_TRUE("copied cells", same_cells);
+		   });
+
+  rubric.criterion("reachability pre-pass", 1,
+		   [&]() {
+         std::mt19937 gen(20181205);
+         std::vector<gnomes::grid> settings = {maze, empty2, horizontal, large_random};
+         for (unsigned i = 0; i < 20; ++i) {
+           // Wide grids cross word boundaries; dense rock leaves much unreachable.
+           settings.push_back(gnomes::grid::random(6 + i, 70 + 7 * i, 60, 150 + 20 * i, gen));
+         }
+
+         bool cells_match = true, spans_match = true, tables_match = true;
+         // One table refilled for every grid, as the batch solvers use it.
+         gnomes::dyn_prog_table pruned;
+         for (auto& setting : settings) {
+           gnomes::dyn_prog_table full;
+           full.fill(setting, false);
+           auto reach = gnomes::reachable_cells(setting);
+           auto spans = gnomes::reachable_spans(setting);
+           for (gnomes::coordinate i = 0; i < setting.rows(); ++i) {
+             gnomes::coordinate first = setting.columns(), last = 0;
+             for (gnomes::coordinate j = 0; j < setting.columns(); ++j) {
+               bool marked = (reach[i * setting.words_per_row() + j / 64] >> (j % 64)) & 1;
+               cells_match = cells_match && (marked == full.is_reachable(i, j));
+               if (full.is_reachable(i, j)) {
+                 first = std::min(first, j);
+                 last = std::max(last, j);
+               }
+             }
+             spans_match = spans_match &&
+                           ((first == setting.columns()) ? spans[i].is_empty()
+                                                          : (spans[i].first == first && spans[i].last == last));
+           }
+
+           pruned.fill(setting);
+           for (gnomes::coordinate i = 0; i < setting.rows(); ++i) {
+             for (gnomes::coordinate j = 0; j < setting.columns(); ++j) {
+               tables_match = tables_match && pruned.gold(i, j) == full.gold(i, j) &&
+                              (!full.is_reachable(i, j) ||
+                               pruned.is_from_left(i, j) == full.is_from_left(i, j));
+             }
+           }
+         }
+         TEST_TRUE("reachable cells", cells_match);
+         TEST_TRUE("spans", spans_match);
+         TEST_TRUE("same table", tables_match);
+
+         gnomes::solver_stats pruned_stats, full_stats;
+         auto blocked = gnomes::grid::random(40, 40, 100, 600, gen);
+         gnomes::dyn_prog_table table;
+         table.fill(blocked, pruned_stats);
+         table.fill(blocked, full_stats, false);
+         TEST_EQUAL("unpruned cells", 40 * 40, full_stats.cells_relaxed);
+         TEST_TRUE("pruned cells", pruned_stats.cells_relaxed < full_stats.cells_relaxed);
+		   });
+
+  rubric.criterion("sparse gold", 1,
+		   [&]() {
+         std::mt19937 gen(20181206);
+         bool gold_matches = true, valid = true;
+         for (unsigned round = 0; round < 40; ++round) {
+           gnomes::coordinate rows = 1 + round % 9, columns = 70 + 3 * round;
+           unsigned gold = (round * 7) % (rows * columns / 2);
+           auto setting = gnomes::grid::random(rows, columns, gold, 0, gen);
+           auto expected = gnomes::greedy_gnomes_dyn_prog(setting),
+                output = gnomes::greedy_gnomes_sparse(setting);
+           gold_matches = gold_matches && output.total_gold() == expected.total_gold();
+
+           std::vector<gnomes::step_direction> moves;
+           for (size_t k = 1; k < output.step_count(); ++k) {
+             moves.push_back(output.direction(k));
+           }
+           gnomes::path walked(setting, moves);
+           valid = valid && walked.total_gold() == output.total_gold() &&
+                   walked.final_row() == output.final_row() &&
+                   walked.final_column() == output.final_column();
+         }
+         TEST_TRUE("same gold as dyn prog", gold_matches);
+         TEST_TRUE("valid paths", valid);
+
+         TEST_EQUAL("no gold", empty4_solution, gnomes::greedy_gnomes_sparse(empty4));
+         TEST_EQUAL("all gold", 6, gnomes::greedy_gnomes_sparse(all_gold).total_gold());
+         TEST_EQUAL("rocks fall back", gnomes::greedy_gnomes_dyn_prog(maze),
+                    gnomes::greedy_gnomes_sparse(maze));
+         TEST_EQUAL("gold count", 6, gnomes::gold_count(small_random));
+         TEST_TRUE("rock free", gnomes::is_rock_free(all_gold) && !gnomes::is_rock_free(maze));
+
+         auto sparse = gnomes::grid::random(300, 500, 1500, 0, gen);
+         TEST_EQUAL("auto", gnomes::greedy_gnomes_dyn_prog(sparse).total_gold(),
+                    gnomes::greedy_gnomes_auto(sparse).total_gold());
+		   });
+
   return rubric.run();
 }
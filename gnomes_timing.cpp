@@ -1,9 +1,12 @@
 ///////////////////////////////////////////////////////////////////////////////
 // gnomes_timing.cpp
 //
-// Example code showing how to run each algorithm while measuring
-// elapsed times precisely. You should modify this program to gather
-// all of your experimental data.
+// A walkthrough of each solver and its features on fixed, seeded inputs:
+// instrumentation, path arenas, thread scaling, incremental edits, batches and
+// so on, each timed once. It is meant for seeing what every feature does, not
+// for gathering experimental data; gnomes_bench sweeps sizes, densities and
+// seeds with warm-up, repetitions and CSV/JSON output, and is what "make"
+// runs.
 //
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -11,14 +14,29 @@
 #include <random>
 #include <iostream>
 
+#define GNOMES_TRACK_ALLOCATIONS
+#include "alloc_tracker.hpp"
 #include "timer.hpp"
 
 #include "gnomes_algs.hpp"
+#include "gnomes_parallel.hpp"
+#include "gnomes_simd.hpp"
+#include "gnomes_io.hpp"
+#include "gnomes_incremental.hpp"
+#include "gnomes_weighted.hpp"
+#include "gnomes_sparse.hpp"
 
 void print_bar() {
   std::cout << std::string(79, '-') << std::endl;
 }
 
+void print_allocations(const AllocationScope& scope, const RssScope& rss) {
+  std::cout << "allocations=" << scope.allocations()
+            << " bytes=" << scope.bytes()
+            << " peak live bytes=" << scope.peak_bytes()
+            << " peak RSS growth=" << rss.peak_growth_kilobytes() << "KB" << std::endl;
+}
+
 int main() {
 
   const size_t EXHAUSTIVE_SEARCH_MAX_N = 50;
@@ -33,7 +51,8 @@ int main() {
   unsigned cells = rows * columns,
            gold_count = cells / 5,  // 20%
            rock_count = cells / 10; // 10%
-  std::mt19937 gen;
+  const unsigned SEED = 1;
+  std::mt19937 gen(SEED);
   gnomes::grid input = gnomes::grid::random(rows, columns, gold_count, rock_count, gen);
 
   Timer timer;
@@ -52,20 +71,361 @@ int main() {
   if (n > EXHAUSTIVE_SEARCH_MAX_N) {
     std::cout << std::endl << "(n too large, skipping exhaustive search)" << std::endl;
   } else {
+    AllocationScope allocations;
+    RssScope rss;
     timer.reset();
     auto exhaustive_output = greedy_gnomes_exhaustive(input);
     elapsed = timer.elapsed();
+    print_allocations(allocations, rss);
     exhaustive_output.print();
     std::cout << std::endl << "elapsed time=" << elapsed << " seconds" << std::endl;
+
+    // Instrumented runs are separate, so the timings above stay unperturbed.
+    gnomes::solver_stats stats;
+    greedy_gnomes_exhaustive(input, stats);
+    stats.print();
+
+    double serial_elapsed = elapsed;
+    size_t max_threads = std::max(1u, std::thread::hardware_concurrency());
+    std::cout << std::endl;
+    for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+      ThreadPool pool(threads);
+      timer.reset();
+      auto parallel_output = greedy_gnomes_exhaustive_parallel(input, pool);
+      elapsed = timer.elapsed();
+      assert(parallel_output.total_gold() == exhaustive_output.total_gold());
+      std::cout << "threads=" << threads
+                << " elapsed time=" << elapsed << " seconds"
+                << " speedup=" << (serial_elapsed / elapsed) << std::endl;
+    }
+  }
+
+  print_bar();
+  const double EXHAUSTIVE_SWEEP_SECONDS = 1.0;
+  std::cout << "exhaustive optimization by n, until a search takes over "
+            << EXHAUSTIVE_SWEEP_SECONDS << " second" << std::endl << std::endl;
+  for (size_t sweep_n = 20; sweep_n <= EXHAUSTIVE_SEARCH_MAX_N; sweep_n += 2) {
+    gnomes::coordinate sweep_rows = sweep_n / 2,
+                       sweep_columns = sweep_n - sweep_rows;
+    unsigned sweep_cells = sweep_rows * sweep_columns;
+    std::mt19937 sweep_gen(sweep_n);
+    auto sweep_input = gnomes::grid::random(sweep_rows, sweep_columns, sweep_cells / 5,
+                                            sweep_cells / 10, sweep_gen);
+    gnomes::solver_stats stats;
+    timer.reset();
+    auto sweep_output = greedy_gnomes_exhaustive(sweep_input, stats);
+    elapsed = timer.elapsed();
+    assert(sweep_output.total_gold() == greedy_gnomes_dyn_prog(sweep_input).total_gold());
+    std::cout << "n=" << sweep_n
+              << ": paths visited=" << stats.candidates_evaluated
+              << " elapsed time=" << elapsed << " seconds" << std::endl;
+    if (elapsed > EXHAUSTIVE_SWEEP_SECONDS) {
+      break;
+    }
+  }
+
+  print_bar();
+  std::cout << "exhaustive optimization, meet in the middle" << std::endl;
+  if (n > EXHAUSTIVE_SEARCH_MAX_N) {
+    std::cout << std::endl << "(n too large, skipping exhaustive search)" << std::endl;
+  } else {
+    AllocationScope allocations;
+    RssScope rss;
+    timer.reset();
+    auto middle_output = greedy_gnomes_exhaustive_meet_in_middle(input);
+    elapsed = timer.elapsed();
+    print_allocations(allocations, rss);
+    middle_output.print();
+    std::cout << std::endl << "elapsed time=" << elapsed << " seconds" << std::endl;
+
+    // Again, with the paths stored in an arena.
+    gnomes::path_arena arena;
+    allocations.reset();
+    rss.reset();
+    timer.reset();
+    auto arena_output = greedy_gnomes_exhaustive_meet_in_middle(input, &arena);
+    elapsed = timer.elapsed();
+    std::cout << "with a path arena:" << std::endl;
+    print_allocations(allocations, rss);
+    std::cout << "elapsed time=" << elapsed << " seconds"
+              << " same gold=" << (arena_output.total_gold() == middle_output.total_gold())
+              << std::endl;
+  }
+
+  print_bar();
+  std::cout << "exhaustive optimization, branch and bound" << std::endl;
+  if (n > EXHAUSTIVE_SEARCH_MAX_N) {
+    std::cout << std::endl << "(n too large, skipping exhaustive search)" << std::endl;
+  } else {
+    gnomes::solver_stats stats;
+    timer.reset();
+    auto bounded_output = greedy_gnomes_exhaustive_bounded(input, stats);
+    elapsed = timer.elapsed();
+    bounded_output.print();
+    std::cout << std::endl << "elapsed time=" << elapsed << " seconds" << std::endl;
+    stats.print();
   }
 
   print_bar();
   std::cout << "dynamic programming" << std::endl;
+  AllocationScope allocations;
+  RssScope rss;
   timer.reset();
   auto dyn_prog_output = greedy_gnomes_dyn_prog(input);
-  elapsed = timer.elapsed();
+  double dyn_prog_elapsed = timer.elapsed();
+  print_allocations(allocations, rss);
   dyn_prog_output.print();
-  std::cout << std::endl << "elapsed time=" << elapsed << " seconds" << std::endl;
+  std::cout << std::endl << "elapsed time=" << dyn_prog_elapsed << " seconds" << std::endl;
+  {
+    gnomes::solver_stats stats;
+    greedy_gnomes_dyn_prog(input, stats);
+    stats.print();
+  }
+
+  print_bar();
+  std::cout << "dynamic programming, linear space" << std::endl;
+  timer.reset();
+  auto linear_space_output = greedy_gnomes_dyn_prog_linear_space(input);
+  elapsed = timer.elapsed();
+  linear_space_output.print();
+  std::cout << std::endl << "elapsed time=" << elapsed << " seconds"
+            << ", " << (elapsed / dyn_prog_elapsed) << "x full table" << std::endl;
+
+  print_bar();
+  const gnomes::coordinate LARGE_N = 2000;
+  std::cout << "score-only dynamic programming, "
+            << LARGE_N << "x" << LARGE_N << " grid" << std::endl << std::endl;
+  auto large_cells = LARGE_N * LARGE_N;
+  gnomes::grid large_input = gnomes::grid::random(LARGE_N, LARGE_N,
+                                                  large_cells / 5, large_cells / 10,
+                                                  gen);
+
+  timer.reset();
+  auto row_sweep_output = greedy_gnomes_dyn_prog_score(large_input);
+  elapsed = timer.elapsed();
+  std::cout << "row sweep: gold=" << row_sweep_output.total_gold
+            << " elapsed time=" << elapsed << " seconds"
+            << " cells/second=" << (large_cells / elapsed) << std::endl;
+
+  const char* level_names[] = { "scalar", "SSE4.1", "AVX2" };
+  for (auto level : {gnomes::SIMD_SCALAR, gnomes::SIMD_SSE41, gnomes::SIMD_AVX2}) {
+    if (!gnomes::is_simd_level_supported(level)) {
+      continue;
+    }
+    timer.reset();
+    auto wavefront_output = greedy_gnomes_dyn_prog_score_wavefront(large_input, level);
+    elapsed = timer.elapsed();
+    assert(wavefront_output.total_gold == row_sweep_output.total_gold);
+    std::cout << "wavefront, " << level_names[level]
+              << ": gold=" << wavefront_output.total_gold
+              << " elapsed time=" << elapsed << " seconds"
+              << " cells/second=" << (large_cells / elapsed) << std::endl;
+  }
+
+  {
+    auto weighted_input = gnomes::weighted_from(large_input);
+    auto report = [&](const char* name, int64_t total_value) {
+      elapsed = timer.elapsed();
+      assert(total_value == row_sweep_output.total_gold);
+      std::cout << "weighted wavefront, " << name << " scores"
+                << ": elapsed time=" << elapsed << " seconds"
+                << " cells/second=" << (large_cells / elapsed) << std::endl;
+    };
+    timer.reset();
+    report("int16", gnomes::weighted_dyn_prog_score<int16_t>(weighted_input).total_value);
+    timer.reset();
+    report("int32", gnomes::weighted_dyn_prog_score<int32_t>(weighted_input).total_value);
+    timer.reset();
+    report("int64", gnomes::weighted_dyn_prog_score<int64_t>(weighted_input).total_value);
+  }
+
+  std::string large_text;
+  for (auto& line : large_input.printable()) {
+    large_text += line + "\n";
+  }
+  timer.reset();
+  auto parsed_input = gnomes::parse_grid_text(large_text.data(), large_text.size());
+  elapsed = timer.elapsed();
+  assert(parsed_input.rows() == large_input.rows());
+  std::cout << "text parse: elapsed time=" << elapsed << " seconds"
+            << " MB/second=" << (large_text.size() / elapsed / 1e6) << std::endl;
+
+  std::cout << std::endl;
+  double one_thread_elapsed = 0, one_thread_path_elapsed = 0;
+  for (size_t threads : {1, 2, 4, 8, 16}) {
+    ThreadPool pool(threads);
+    auto tiles = gnomes::wavefront_tile_shape(LARGE_N, LARGE_N, threads);
+    timer.reset();
+    auto tiled_output = greedy_gnomes_dyn_prog_score_parallel(large_input, pool);
+    elapsed = timer.elapsed();
+    assert(tiled_output.total_gold == row_sweep_output.total_gold);
+    timer.reset();
+    auto tiled_path = greedy_gnomes_dyn_prog_parallel(large_input, pool);
+    double path_elapsed = timer.elapsed();
+    assert(tiled_path.total_gold() == row_sweep_output.total_gold);
+    if (threads == 1) {
+      one_thread_elapsed = elapsed;
+      one_thread_path_elapsed = path_elapsed;
+    }
+    std::cout << "tiled wavefront, threads=" << threads
+              << " tiles=" << ((LARGE_N + tiles.rows - 1) / tiles.rows) << "x"
+              << ((LARGE_N + tiles.columns - 1) / tiles.columns)
+              << ": score=" << elapsed << " seconds"
+              << " speedup=" << (one_thread_elapsed / elapsed)
+              << ", path=" << path_elapsed << " seconds"
+              << " speedup=" << (one_thread_path_elapsed / path_elapsed) << std::endl;
+  }
+
+  print_bar();
+  const gnomes::coordinate PRUNE_N = 1000;
+  std::cout << "reachability pre-pass, " << PRUNE_N << "x" << PRUNE_N
+            << " grids" << std::endl << std::endl;
+  for (double rock_density : {0.1, 0.2, 0.3, 0.4}) {
+    auto prune_cells = PRUNE_N * PRUNE_N;
+    auto prune_input = gnomes::grid::random(PRUNE_N, PRUNE_N, prune_cells / 5,
+                                            unsigned(prune_cells * rock_density), gen);
+    gnomes::dyn_prog_table table;
+    gnomes::solver_stats full_stats, pruned_stats;
+
+    // Best of a few fills each, alternating, into an already-sized table.
+    table.fill(prune_input, false);
+    double full_elapsed = 0, pruned_elapsed = 0;
+    for (int rep = 0; rep < 5; ++rep) {
+      full_stats = pruned_stats = gnomes::solver_stats();
+      timer.reset();
+      table.fill(prune_input, full_stats, false);
+      elapsed = timer.elapsed();
+      full_elapsed = (rep == 0) ? elapsed : std::min(full_elapsed, elapsed);
+      timer.reset();
+      table.fill(prune_input, pruned_stats);
+      elapsed = timer.elapsed();
+      pruned_elapsed = (rep == 0) ? elapsed : std::min(pruned_elapsed, elapsed);
+    }
+
+    std::cout << "rock=" << int(rock_density * 100) << "%"
+              << ": live cells=" << (double(pruned_stats.cells_relaxed) / prune_cells)
+              << " full fill=" << full_elapsed << " seconds"
+              << " pruned fill=" << pruned_elapsed << " seconds"
+              << " (pre-pass " << pruned_stats.phase_seconds[gnomes::PHASE_INIT] << ")"
+              << " speedup=" << (full_elapsed / pruned_elapsed) << std::endl;
+  }
+
+  print_bar();
+  std::cout << "sparse gold, " << LARGE_N << "x" << LARGE_N
+            << " grids without rocks" << std::endl << std::endl;
+  for (double gold_density : {0.001, 0.01, 0.05}) {
+    auto sparse_input = gnomes::grid::random(LARGE_N, LARGE_N,
+                                             unsigned(LARGE_N * LARGE_N * gold_density),
+                                             0, gen);
+    timer.reset();
+    auto dense_output = greedy_gnomes_dyn_prog(sparse_input);
+    double dense_elapsed = timer.elapsed();
+    timer.reset();
+    auto sparse_output = greedy_gnomes_sparse(sparse_input);
+    double sparse_elapsed = timer.elapsed();
+    assert(sparse_output.total_gold() == dense_output.total_gold());
+
+    std::cout << "gold=" << (gold_density * 100) << "%"
+              << ": dyn prog=" << dense_elapsed << " seconds"
+              << " sparse=" << sparse_elapsed << " seconds"
+              << " speedup=" << (dense_elapsed / sparse_elapsed) << std::endl;
+  }
+
+  print_bar();
+  const unsigned EDIT_ROUNDS = 100, EDITS_PER_ROUND = 4;
+  std::cout << "incremental dynamic programming, " << LARGE_N << "x" << LARGE_N
+            << " grid, " << EDIT_ROUNDS << " rounds of " << EDITS_PER_ROUND
+            << " edits" << std::endl << std::endl;
+  {
+    timer.reset();
+    auto full_output = greedy_gnomes_dyn_prog(large_input);
+    double full_elapsed = timer.elapsed();
+    std::cout << "full solve: gold=" << full_output.total_gold()
+              << " elapsed time=" << full_elapsed << " seconds" << std::endl;
+
+    gnomes::incremental_dyn_prog solver(large_input);
+    gnomes::solver_stats stats;
+    std::uniform_int_distribution<gnomes::coordinate> position(1, LARGE_N - 1);
+    std::uniform_int_distribution<int> kind(0, 2);
+    timer.reset();
+    for (unsigned round = 0; round < EDIT_ROUNDS; ++round) {
+      std::vector<gnomes::cell_edit> edits;
+      for (unsigned k = 0; k < EDITS_PER_ROUND; ++k) {
+        edits.push_back({ position(gen), position(gen), gnomes::cell_kind(kind(gen)) });
+      }
+      solver.apply(edits, stats);
+    }
+    elapsed = timer.elapsed() / EDIT_ROUNDS;
+    std::cout << "incremental: cells recomputed per round="
+              << (stats.cells_relaxed / EDIT_ROUNDS)
+              << " elapsed time per round=" << elapsed << " seconds"
+              << " speedup=" << (full_elapsed / elapsed) << std::endl;
+  }
+
+  print_bar();
+  const size_t QUERY_COUNT = 10000;
+  std::cout << "best path index, " << LARGE_N << "x" << LARGE_N << " grid, "
+            << QUERY_COUNT << " queries" << std::endl << std::endl;
+  {
+    timer.reset();
+    gnomes::best_path_index index(large_input);
+    elapsed = timer.elapsed();
+    std::cout << "build: elapsed time=" << elapsed << " seconds" << std::endl;
+
+    std::vector<gnomes::grid_cell> queries;
+    std::uniform_int_distribution<gnomes::coordinate> position(0, LARGE_N - 1);
+    while (queries.size() < QUERY_COUNT) {
+      gnomes::grid_cell cell = { position(gen), position(gen) };
+      if (index.is_reachable(cell.row, cell.column)) {
+        queries.push_back(cell);
+      }
+    }
+
+    timer.reset();
+    auto golds = index.max_gold(queries);
+    elapsed = timer.elapsed();
+    std::cout << "max gold: queries/second=" << (QUERY_COUNT / elapsed) << std::endl;
+
+    gnomes::path_arena arena;
+    timer.reset();
+    auto paths = index.paths_to(queries, &arena);
+    elapsed = timer.elapsed();
+    assert(paths.back().total_gold() == golds.back());
+    std::cout << "path: queries/second=" << (QUERY_COUNT / elapsed) << std::endl;
+  }
+
+  print_bar();
+  const size_t BATCH_SIZE = 10000;
+  const gnomes::coordinate BATCH_N = 20;
+  std::cout << "batches of " << BATCH_SIZE << " " << BATCH_N << "x" << BATCH_N
+            << " grids" << std::endl << std::endl;
+  std::vector<gnomes::grid> batch;
+  for (size_t i = 0; i < BATCH_SIZE; ++i) {
+    batch.push_back(gnomes::grid::random(BATCH_N, BATCH_N,
+                                         BATCH_N * BATCH_N / 5, BATCH_N * BATCH_N / 10,
+                                         gen));
+  }
+
+  timer.reset();
+  for (auto& setting : batch) {
+    greedy_gnomes_dyn_prog(setting);
+  }
+  elapsed = timer.elapsed();
+  std::cout << "one call per grid: grids/second=" << (BATCH_SIZE / elapsed) << std::endl;
+
+  {
+    ThreadPool pool;
+    timer.reset();
+    greedy_gnomes_dyn_prog_batch(batch, &pool);
+    elapsed = timer.elapsed();
+    std::cout << "path batch: grids/second=" << (BATCH_SIZE / elapsed) << std::endl;
+
+    timer.reset();
+    greedy_gnomes_dyn_prog_score_batch(batch, &pool);
+    elapsed = timer.elapsed();
+    std::cout << "score batch, " << gnomes::BATCH_LANES << " lanes: grids/second="
+              << (BATCH_SIZE / elapsed) << std::endl;
+  }
 
   print_bar();
 
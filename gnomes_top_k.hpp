@@ -0,0 +1,241 @@
+///////////////////////////////////////////////////////////////////////////////
+// gnomes_top_k.hpp
+//
+// Finding the k best paths for the greedy gnomes problem, for callers that
+// want several good routes rather than one.
+//
+// The k best paths ending at a cell all continue one of the k best paths
+// ending at the cell above or the cell to the left, so keeping a ranked list
+// of up to k (gold, predecessor) entries per cell is enough to find them.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <queue>
+#include <vector>
+#include "gnomes_algs.hpp"
+
+namespace gnomes {
+
+// Table of the k best paths ending at each cell of a grid.
+//
+// Each cell holds up to k entries, best first. An entry records the gold of
+// one path and where it came from: which neighbor, and the rank of the path
+// to that neighbor that it extends. Entries with equal gold are ranked with
+// paths from above first, then by the rank of the path they extend, so every
+// ranking is deterministic and rank 0 is always the path greedy_gnomes_dyn_prog
+// would choose for that cell.
+class top_k_table {
+private:
+  struct entry {
+    unsigned gold;
+    // Rank of the predecessor's entry, times two, plus one if it is the cell
+    // to the left.
+    uint32_t from;
+  };
+
+  coordinate rows_, columns_;
+  size_t k_;
+  std::vector<entry> entries_;
+  std::vector<uint32_t> counts_;
+
+  size_t index(coordinate row, coordinate column) const {
+    assert(row < rows_);
+    assert(column < columns_);
+    return row * columns_ + column;
+  }
+
+  const entry& at(coordinate row, coordinate column, size_t rank) const {
+    assert(rank < count(row, column));
+    return entries_[index(row, column) * k_ + rank];
+  }
+
+public:
+
+  // Create an empty table; call fill before querying it.
+  top_k_table()
+  : rows_(0), columns_(0), k_(0) { }
+
+  // Accessors.
+  coordinate rows() const { return rows_; }
+  coordinate columns() const { return columns_; }
+  size_t k() const { return k_; }
+
+  // Return the number of distinct paths ranked for the given cell, which is
+  // the smaller of k and the number of valid paths ending there.
+  size_t count(coordinate row, coordinate column) const {
+    return counts_[index(row, column)];
+  }
+
+  // Return the gold of the path with the given rank ending at the given cell.
+  unsigned gold(coordinate row, coordinate column, size_t rank) const {
+    return at(row, column, rank).gold;
+  }
+
+  // Fill the table for the given grid, keeping up to k paths per cell, and
+  // report to stats. Takes O(rows*columns*k) time and space; storage is
+  // reused when the table is refilled.
+  template <typename Stats>
+  void fill(const grid& setting, size_t k, Stats& stats) {
+    assert(k > 0);
+
+    stats.begin_phase(PHASE_INIT);
+    rows_ = setting.rows();
+    columns_ = setting.columns();
+    k_ = k;
+    entries_.resize(rows_ * columns_ * k_);
+    counts_.assign(rows_ * columns_, 0);
+    stats.end_phase(PHASE_INIT);
+
+    stats.begin_phase(PHASE_FILL);
+    for (coordinate i = 0; i < rows_; ++i) {
+      for (coordinate j = 0; j < columns_; ++j) {
+        stats.count_cell_relaxed();
+        auto cell = setting.get(i, j);
+        if (cell == CELL_ROCK) {
+          continue;
+        }
+
+        const size_t here = index(i, j);
+        entry* out = &entries_[here * k_];
+        if (i == 0 && j == 0) {
+          out[0] = entry{ 0, 0 };
+          counts_[here] = 1;
+          continue;
+        }
+
+        // Merge the two ranked lists, which are already sorted best first.
+        const entry* above = (i > 0) ? &entries_[index(i - 1, j) * k_] : nullptr;
+        const entry* left = (j > 0) ? &entries_[index(i, j - 1) * k_] : nullptr;
+        const uint32_t above_count = above ? counts_[index(i - 1, j)] : 0,
+                       left_count = left ? counts_[index(i, j - 1)] : 0;
+        const unsigned add = (cell == CELL_GOLD) ? 1 : 0;
+        uint32_t a = 0, l = 0, n = 0;
+        while (n < k_ && (a < above_count || l < left_count)) {
+          stats.count_candidate();
+          if (l == left_count ||
+              (a < above_count && above[a].gold >= left[l].gold)) {
+            out[n++] = entry{ above[a].gold + add, 2 * a };
+            ++a;
+          } else {
+            out[n++] = entry{ left[l].gold + add, 2 * l + 1 };
+            ++l;
+          }
+        }
+        counts_[here] = n;
+      }
+    }
+    stats.end_phase(PHASE_FILL);
+  }
+
+  void fill(const grid& setting, size_t k) {
+    no_stats stats;
+    fill(setting, k, stats);
+  }
+
+  // Rebuild the path with the given rank ending at the given cell, in time
+  // proportional to its length. The path is stored in arena, or on the heap
+  // if it is null.
+  path backtrack(const grid& setting, coordinate row, coordinate column,
+                 size_t rank, path_arena* arena = nullptr) const {
+    assert(setting.rows() == rows_);
+    assert(setting.columns() == columns_);
+
+    const unsigned total_gold = gold(row, column, rank);
+    return path(setting, row, column, total_gold,
+                [this, rank](coordinate i, coordinate j) mutable {
+                  uint32_t from = at(i, j, rank).from;
+                  rank = from / 2;
+                  return (from & 1) != 0;
+                },
+                arena);
+  }
+};
+
+// Solve the greedy gnomes problem for the given grid, returning its k best
+// distinct paths, best first, or all of them if there are fewer than k.
+//
+// Paths are ranked by gold; ties go to the path ending at the earlier cell in
+// row-major order, and then to the better-ranked path within that cell as
+// top_k_table ranks them. So the first path is always the one
+// greedy_gnomes_dyn_prog returns. Filling the table takes O(rows*columns*k)
+// time, and choosing the best entries over all cells with a heap of size k
+// takes O(rows*columns*k*log(k)).
+//
+// The solve is reported to stats, a statistics policy from gnomes_stats.hpp.
+// When arena is not null, the returned paths are stored in it.
+//
+// The grid must be non-empty, and k must be positive.
+template <typename Stats>
+std::vector<path> greedy_gnomes_dyn_prog_top_k(const grid& setting, size_t k,
+                                               top_k_table& table, Stats& stats,
+                                               path_arena* arena = nullptr) {
+  assert(setting.rows() > 0);
+  assert(setting.columns() > 0);
+  assert(k > 0);
+
+  table.fill(setting, k, stats);
+
+  stats.begin_phase(PHASE_POST);
+  // A candidate is a cell index and a rank within it. The heap keeps the k
+  // best seen so far, with the worst of them on top.
+  struct candidate {
+    unsigned gold;
+    size_t cell, rank;
+  };
+  auto is_better = [](const candidate& a, const candidate& b) {
+    return (a.gold > b.gold) ||
+           (a.gold == b.gold && (a.cell < b.cell ||
+                                 (a.cell == b.cell && a.rank < b.rank)));
+  };
+  std::priority_queue<candidate, std::vector<candidate>, decltype(is_better)>
+    heap(is_better);
+
+  for (coordinate i = 0; i < setting.rows(); ++i) {
+    for (coordinate j = 0; j < setting.columns(); ++j) {
+      const size_t cell = i * setting.columns() + j;
+      for (size_t rank = 0; rank < table.count(i, j); ++rank) {
+        candidate c{ table.gold(i, j, rank), cell, rank };
+        if (heap.size() < k) {
+          heap.push(c);
+        } else if (is_better(c, heap.top())) {
+          heap.pop();
+          heap.push(c);
+        } else {
+          // Later ranks of this cell are no better.
+          break;
+        }
+      }
+    }
+  }
+
+  std::vector<candidate> best;
+  best.reserve(heap.size());
+  for (; !heap.empty(); heap.pop()) {
+    best.push_back(heap.top());
+  }
+  std::reverse(best.begin(), best.end());
+
+  std::vector<path> result;
+  result.reserve(best.size());
+  for (auto& c : best) {
+    result.push_back(table.backtrack(setting, c.cell / setting.columns(),
+                                     c.cell % setting.columns(), c.rank, arena));
+    stats.count_path_copy();
+  }
+  stats.end_phase(PHASE_POST);
+  return result;
+}
+
+std::vector<path> greedy_gnomes_dyn_prog_top_k(const grid& setting, size_t k,
+                                               path_arena* arena = nullptr) {
+  top_k_table table;
+  no_stats stats;
+  return greedy_gnomes_dyn_prog_top_k(setting, k, table, stats, arena);
+}
+
+}
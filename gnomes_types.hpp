@@ -11,7 +11,10 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
+#include <memory>
 #include <random>
 #include <string>
 #include <vector>
@@ -24,25 +27,136 @@ using coordinate = size_t;
 // Type for one element of the map grid.
 enum cell_kind { CELL_EARTH, CELL_ROCK, CELL_GOLD };
 
+// Type for one 64-cell word of a grid row.
+using row_word = uint64_t;
+
+// Number of cells packed into each row_word.
+const coordinate CELLS_PER_WORD = 64;
+
 // Type for a rectangular grid representing the map.
+//
+// Cells are stored as two bitboards, one marking gold cells and one marking
+// rock cells, so a cell takes two bits instead of a whole cell_kind. Each row
+// starts on a fresh row_word, bit k of word w holds column 64*w+k, and the
+// unused bits at the end of a row are always zero. Solvers may use gold_row
+// and rock_row to process 64 cells at a time.
+//
+// A grid normally owns its bitboards. A grid created by view instead reads
+// bitboards stored elsewhere, such as a memory-mapped file, without copying
+// them; views are read-only.
 class grid {
 private:
-  std::vector<std::vector<cell_kind>> cells_;
+  coordinate rows_, columns_, words_per_row_;
+  // Owned storage: the gold bitboard followed by the rock bitboard. Empty for
+  // a view.
+  std::vector<row_word> words_;
+  const row_word* gold_;
+  const row_word* rock_;
+  // Keeps the storage of a view alive.
+  std::shared_ptr<const void> owner_;
+
+  size_t word_index(coordinate row, coordinate column) const {
+    return row * words_per_row_ + column / CELLS_PER_WORD;
+  }
+
+  static row_word bit(coordinate column) {
+    return row_word(1) << (column % CELLS_PER_WORD);
+  }
+
+  static coordinate words_for(coordinate columns) {
+    return (columns + CELLS_PER_WORD - 1) / CELLS_PER_WORD;
+  }
+
+  void point_at_words() {
+    gold_ = words_.data();
+    rock_ = gold_ + (rows_ * words_per_row_);
+  }
+
+  struct view_tag { };
+
+  grid(view_tag, coordinate rows, coordinate columns,
+       const row_word* gold, const row_word* rock,
+       std::shared_ptr<const void> owner)
+  : rows_(rows),
+    columns_(columns),
+    words_per_row_(words_for(columns)),
+    gold_(gold),
+    rock_(rock),
+    owner_(owner) {
+
+    assert(rows > 0);
+    assert(columns > 0);
+  }
 
 public:
 
   // Create a grid with the given number of rows and columns, all initialized
   // to hold CELL_EARTH.
   grid(coordinate rows, coordinate columns)
-  : cells_(rows, std::vector<cell_kind>(columns, CELL_EARTH)) {
+  : rows_(rows),
+    columns_(columns),
+    words_per_row_(words_for(columns)),
+    words_(2 * rows * words_per_row_, 0) {
 
     assert(rows > 0);
     assert(columns > 0);
+    point_at_words();
+  }
+
+  // Copying an owned grid copies its bitboards; copying a view makes another
+  // view of the same storage.
+  grid(const grid& o)
+  : rows_(o.rows_),
+    columns_(o.columns_),
+    words_per_row_(o.words_per_row_),
+    words_(o.words_),
+    gold_(o.gold_),
+    rock_(o.rock_),
+    owner_(o.owner_) {
+
+    if (!is_view()) {
+      point_at_words();
+    }
+  }
+
+  grid& operator=(const grid& o) {
+    grid copy(o);
+    return *this = std::move(copy);
+  }
+
+  // Moving keeps the same storage, so the bitboard pointers stay valid.
+  grid(grid&&) = default;
+  grid& operator=(grid&&) = default;
+
+  // Create a read-only grid over the given bitboards, which must be laid out
+  // as described above and stay valid for as long as owner, or a copy of it,
+  // is alive. (0, 0) must be CELL_EARTH.
+  static grid view(coordinate rows, coordinate columns,
+                   const row_word* gold, const row_word* rock,
+                   std::shared_ptr<const void> owner) {
+    return grid(view_tag(), rows, columns, gold, rock, owner);
   }
 
   // Accessors.
-  coordinate rows() const { return cells_.size(); }
-  coordinate columns() const { return cells_.front().size(); }
+  coordinate rows() const { return rows_; }
+  coordinate columns() const { return columns_; }
+
+  // Return true if this grid reads storage it does not own.
+  bool is_view() const { return words_.empty(); }
+
+  // Number of row_words used to store each row.
+  coordinate words_per_row() const { return words_per_row_; }
+
+  // Return the first of the words_per_row() bitboard words for the gold or
+  // rock cells in the given row.
+  const row_word* gold_row(coordinate row) const {
+    assert(is_row(row));
+    return gold_ + (row * words_per_row_);
+  }
+  const row_word* rock_row(coordinate row) const {
+    assert(is_row(row));
+    return rock_ + (row * words_per_row_);
+  }
 
   // Test whether the given value is a valid row or column number.
   bool is_row(coordinate row) const { return row < rows(); }
@@ -54,19 +168,39 @@ public:
   // Return the cell at the given row and column.
   cell_kind get(coordinate row, coordinate column) const {
     assert(is_row_column(row, column));
-    return cells_[row][column];
+    auto k = word_index(row, column);
+    auto b = bit(column);
+    if (gold_[k] & b) {
+      return CELL_GOLD;
+    } else if (rock_[k] & b) {
+      return CELL_ROCK;
+    } else {
+      return CELL_EARTH;
+    }
   }
 
   // Set the contents of the cell at the given row and column.
   // (0, 0) may only be CELL_EARTH. Other coordinates may be any kind.
+  // The grid must not be a view.
   void set(coordinate row, coordinate column, cell_kind kind) {
     assert(is_row_column(row, column));
+    assert(!is_view());
 
     if ((row == 0) && (column == 0)) {
       assert(kind == CELL_EARTH);
     }
 
-    cells_[row][column] = kind;
+    auto k = word_index(row, column);
+    auto b = bit(column);
+    auto& gold = words_[k];
+    auto& rock = words_[(rows_ * words_per_row_) + k];
+    gold &= ~b;
+    rock &= ~b;
+    if (kind == CELL_GOLD) {
+      gold |= b;
+    } else if (kind == CELL_ROCK) {
+      rock |= b;
+    }
   }
 
   // Return true if it is valid to step into the given row and column.
@@ -74,7 +208,7 @@ public:
   // that cell is not CELL_ROCK.
   bool may_step(coordinate row, coordinate column) const {
     return (is_row_column(row, column) &&
-            (cells_[row][column] != CELL_ROCK));
+            !(rock_[word_index(row, column)] & bit(column)));
   }
 
   // Return strings corresponding to lines of text in a human-readable
@@ -209,6 +343,119 @@ public:
   }
 };
 
+// Bump allocator that hands out storage for paths.
+//
+// Memory is carved from large blocks and never freed individually; reset
+// makes all of it available again at once, keeping the blocks for the next
+// solve. Paths given an arena take their storage from it, so a solve that
+// creates and copies many paths makes almost no calls to the heap, and a
+// long-running process that solves repeatedly reuses the same blocks instead
+// of fragmenting the heap.
+//
+// Every path using an arena must be destroyed, or no longer used, before the
+// arena is reset or destroyed. An arena is not thread-safe.
+class path_arena {
+private:
+  struct block {
+    std::unique_ptr<char[]> bytes;
+    size_t size;
+  };
+
+  size_t block_size_;
+  std::vector<block> blocks_;
+  // Block currently being carved, and the bytes already used in it.
+  size_t current_, used_;
+
+  static size_t round_up(size_t bytes) {
+    const size_t align = alignof(std::max_align_t);
+    return (bytes + align - 1) / align * align;
+  }
+
+public:
+
+  // Create an empty arena that allocates blocks of at least the given size,
+  // in bytes, as needed.
+  explicit path_arena(size_t block_size = 64 * 1024)
+  : block_size_(round_up(std::max<size_t>(block_size, 1))),
+    current_(0),
+    used_(0) { }
+
+  path_arena(const path_arena&) = delete;
+  path_arena& operator=(const path_arena&) = delete;
+
+  // Return the given number of bytes of storage, aligned for any fundamental
+  // type.
+  void* allocate(size_t bytes) {
+    bytes = round_up(bytes);
+    for (; current_ < blocks_.size(); ++current_, used_ = 0) {
+      if (blocks_[current_].size - used_ >= bytes) {
+        void* result = blocks_[current_].bytes.get() + used_;
+        used_ += bytes;
+        return result;
+      }
+    }
+
+    const size_t size = std::max(block_size_, bytes);
+    blocks_.push_back(block{ std::unique_ptr<char[]>(new char[size]), size });
+    used_ = bytes;
+    return blocks_.back().bytes.get();
+  }
+
+  // Make all storage available again, invalidating every path using it.
+  void reset() {
+    current_ = used_ = 0;
+  }
+
+  // Return the total size of the blocks held, in bytes.
+  size_t capacity() const {
+    size_t total = 0;
+    for (auto& b : blocks_) {
+      total += b.size;
+    }
+    return total;
+  }
+};
+
+// Standard allocator that takes storage from a path_arena, or from the heap
+// when the arena is null. Containers copied from one using an arena use the
+// same arena.
+template <typename T>
+class arena_allocator {
+private:
+  path_arena* arena_;
+
+  template <typename U> friend class arena_allocator;
+
+public:
+  using value_type = T;
+
+  arena_allocator(path_arena* arena = nullptr) : arena_(arena) { }
+
+  template <typename U>
+  arena_allocator(const arena_allocator<U>& o) : arena_(o.arena_) { }
+
+  path_arena* arena() const { return arena_; }
+
+  T* allocate(size_t n) {
+    if (arena_) {
+      return static_cast<T*>(arena_->allocate(n * sizeof(T)));
+    } else {
+      return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+  }
+
+  void deallocate(T* p, size_t) {
+    if (!arena_) {
+      ::operator delete(p);
+    }
+  }
+
+  template <typename U>
+  bool operator==(const arena_allocator<U>& o) const { return arena_ == o.arena_; }
+  template <typename U>
+  bool operator!=(const arena_allocator<U>& o) const { return arena_ != o.arena_; }
+};
+
 // A path represents a sequence of valid steps in a particular grid.
 //
 // The first step must always be STEP_DIRECTION_START, and subsequent steps
@@ -220,34 +467,54 @@ public:
 // This class tracks the ending position, and total gold, of the path, in order
 // to make it easier to compare candidate solutions in the exhaustive search
 // algorithm.
+//
+// Since every step after the start is either right or down, the steps are
+// packed one bit each (1 for right, 0 for down) into words sized for the
+// longest possible path in the grid. Copying a path therefore costs about
+// (rows+columns)/8 bytes, and adding a step never reallocates. The words come
+// from the heap, or from a path_arena given when the path is created; copies
+// of a path use the same arena.
 class path {
 private:
   const grid* setting_;
-  std::vector<step> steps_;
+  std::vector<row_word, arena_allocator<row_word>> moves_;
+  size_t length_;
   coordinate final_row_, final_column_;
   unsigned total_gold_;
 
   // Helper function to initialize all data members, called by the two
   // constructors below.
   void initialize(const grid& setting) {
-    assert(steps_.empty());
     setting_ = &setting;
-    steps_.emplace_back(STEP_DIRECTION_START);
+    auto max_moves = setting.rows() + setting.columns() - 2;
+    moves_.assign((max_moves + CELLS_PER_WORD - 1) / CELLS_PER_WORD, 0);
+    length_ = 0;
     final_row_ = final_column_ = 0;
     total_gold_ = 0;
   }
 
+  // Return true if move k, counting from 0 after the start, is to the right.
+  bool is_right(size_t k) const {
+    return (moves_[k / CELLS_PER_WORD] >> (k % CELLS_PER_WORD)) & 1;
+  }
+
 public:
 
   // Create an empty path, containing only one STEP_DIRECTION_START step
-  // and no other steps.
-  path(const grid& setting) { initialize(setting); }
+  // and no other steps, stored in the given arena, or on the heap if it is
+  // null.
+  path(const grid& setting, path_arena* arena = nullptr)
+  : moves_(arena_allocator<row_word>(arena)) {
+    initialize(setting);
+  }
 
   // Create a path containing one STEP_DIRECTION_START step followed by the
   // steps in steps_after_start, which must all be valid. This constructor is
   // intended to make unit testing easier and probably does not need to be used
   // by the algorithms.
-  path(const grid& setting, const std::vector<step_direction>& steps_after_start) {
+  path(const grid& setting, const std::vector<step_direction>& steps_after_start,
+       path_arena* arena = nullptr)
+  : moves_(arena_allocator<row_word>(arena)) {
     initialize(setting);
     for (auto& step : steps_after_start) {
       assert(is_step_valid(step));
@@ -255,15 +522,84 @@ public:
     }
   }
 
+  // Create the path ending at (final_row, final_column) that collects
+  // total_gold, learning its moves by calling is_from_left(row, column) for
+  // each cell it visits after the start, from the end back towards (0, 0);
+  // that returns true when the path entered the cell from the left. Nothing
+  // is checked and the grid is not read, so this takes time proportional to
+  // the path's length; it is meant for solvers that have recorded each
+  // cell's predecessor.
+  template <typename FromLeft>
+  path(const grid& setting, coordinate final_row, coordinate final_column,
+       unsigned total_gold, FromLeft is_from_left, path_arena* arena = nullptr)
+  : moves_(arena_allocator<row_word>(arena)) {
+    initialize(setting);
+    length_ = final_row + final_column;
+    final_row_ = final_row;
+    final_column_ = final_column;
+    total_gold_ = total_gold;
+
+    coordinate row = final_row, column = final_column;
+    for (size_t k = length_; k > 0; --k) {
+      if (is_from_left(row, column)) {
+        moves_[(k - 1) / CELLS_PER_WORD] |= row_word(1) << ((k - 1) % CELLS_PER_WORD);
+        --column;
+      } else {
+        --row;
+      }
+    }
+    assert(row == 0 && column == 0);
+  }
+
+  // Copy o into storage from the given arena, or from the heap if it is null;
+  // for instance, to keep a path found using an arena after resetting it.
+  path(const path& o, path_arena* arena)
+  : setting_(o.setting_),
+    moves_(o.moves_.begin(), o.moves_.end(), arena_allocator<row_word>(arena)),
+    length_(o.length_),
+    final_row_(o.final_row_),
+    final_column_(o.final_column_),
+    total_gold_(o.total_gold_) { }
+
+  path(const path&) = default;
+  path(path&&) = default;
+  path& operator=(const path&) = default;
+  path& operator=(path&&) = default;
+
   // Accessors.
   const grid& setting() const { return *setting_; }
-  const std::vector<step>& steps() const { return steps_; }
+  path_arena* arena() const { return moves_.get_allocator().arena(); }
   coordinate final_row() const { return final_row_; }
   coordinate final_column() const { return final_column_; }
   unsigned total_gold() const { return total_gold_; }
 
+  // Return the number of steps, including the STEP_DIRECTION_START step.
+  size_t step_count() const { return length_ + 1; }
+
+  // Return the direction of step k, where step 0 is STEP_DIRECTION_START.
+  step_direction direction(size_t k) const {
+    assert(k < step_count());
+    if (k == 0) {
+      return STEP_DIRECTION_START;
+    } else if (is_right(k - 1)) {
+      return STEP_DIRECTION_RIGHT;
+    } else {
+      return STEP_DIRECTION_DOWN;
+    }
+  }
+
+  // Return all the steps, unpacked.
+  std::vector<step> steps() const {
+    std::vector<step> result;
+    result.reserve(step_count());
+    for (size_t k = 0; k < step_count(); ++k) {
+      result.emplace_back(direction(k));
+    }
+    return result;
+  }
+
   // Return the last step in the path.
-  const step& last_step() const { return steps_.back(); }
+  step last_step() const { return step(direction(length_)); }
 
   // Return the row/column number that we would be in if we took one more step
   // in the given direction.
@@ -278,10 +614,8 @@ public:
   // is not STEP_DIRECTION_START, it stays inside the grid, and it does not
   // try to step into a CELL_ROCK cell.
   bool is_step_valid(step_direction dir) const {
-    auto row = row_after(dir), column = column_after(dir);
     return ((dir != STEP_DIRECTION_START) &&
-            setting_->is_row_column(row, column) &&
-            (setting_->get(row, column) != CELL_ROCK));
+            setting_->may_step(row_after(dir), column_after(dir)));
   }
 
   // Add one step, which must be valid as determined by is_step_valid.
@@ -289,7 +623,10 @@ public:
 
     assert(is_step_valid(dir));
 
-    steps_.emplace_back(dir);
+    if (dir == STEP_DIRECTION_RIGHT) {
+      moves_[length_ / CELLS_PER_WORD] |= row_word(1) << (length_ % CELLS_PER_WORD);
+    }
+    ++length_;
 
     // Update final row, column, and total gold.
     final_row_ = row_after(dir);
@@ -299,6 +636,27 @@ public:
     }
   }
 
+  // Remove the last step, which must not be the STEP_DIRECTION_START step,
+  // undoing its add_step. This lets a search extend one path in place and
+  // backtrack without copying.
+  void pop_step() {
+    assert(length_ > 0);
+
+    if (setting_->get(final_row_, final_column_) == CELL_GOLD) {
+      --total_gold_;
+    }
+
+    --length_;
+    auto& word = moves_[length_ / CELLS_PER_WORD];
+    row_word b = row_word(1) << (length_ % CELLS_PER_WORD);
+    if (word & b) {
+      word &= ~b;
+      --final_column_;
+    } else {
+      --final_row_;
+    }
+  }
+
   // Return strings corresponding to lines of text in a human-readable
   // representation of the path super-imposed on top of its grid.
   std::vector<std::string> printable() const {
@@ -306,8 +664,9 @@ public:
     auto lines = setting_->printable();
 
     coordinate row = 0, column = 0;
-    for (auto& s : steps_) {
+    for (size_t k = 0; k < step_count(); ++k) {
 
+      step s(direction(k));
       row += s.delta_row();
       column += s.delta_column();
 
@@ -329,14 +688,28 @@ public:
     for (auto& line : printable()) {
       std::cout << line << std::endl;
     }
-    std::cout << "steps=" << steps_.size()
+    std::cout << "steps=" << step_count()
               << " gold=" << total_gold_
               << std::endl;
   }
 
-  // Equality operator, for unit testing.
+  // Equality operator, for unit testing. As with comparing unpacked steps
+  // element by element, this path equals o when its steps are a prefix of o's
+  // steps.
   bool operator==(const path& o) const {
-    return std::equal(steps_.begin(), steps_.end(), o.steps_.begin());
+    if (length_ > o.length_) {
+      return false;
+    }
+    size_t whole = length_ / CELLS_PER_WORD,
+           rest = length_ % CELLS_PER_WORD;
+    if (!std::equal(moves_.begin(), moves_.begin() + whole, o.moves_.begin())) {
+      return false;
+    }
+    if (rest == 0) {
+      return true;
+    }
+    row_word mask = (row_word(1) << rest) - 1;
+    return (moves_[whole] & mask) == (o.moves_[whole] & mask);
   }
 
 };
@@ -0,0 +1,375 @@
+///////////////////////////////////////////////////////////////////////////////
+// gnomes_weighted.hpp
+//
+// The greedy gnomes problem with a value on every cell.
+//
+// Instead of earth and gold, each open cell of a weighted_grid holds a value
+// of some integer type, which may be negative, and a path scores the sum of
+// the values of the cells it enters. Rocks still block paths.
+//
+// Solvers are templated on the type used to add up scores. narrowest_score
+// picks, at compile time, the narrowest signed type that cannot overflow for
+// given bounds on the cell values and path length, so small problems run on
+// 8- or 16-bit lanes, which the wavefront's inner loop packs many of into each
+// vector register. The *_auto functions check the bounds of an actual grid
+// and dispatch to the narrowest instantiation. An ordinary grid maps onto
+// weighted_grid<uint8_t> with gold worth 1.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <vector>
+#include "gnomes_types.hpp"
+
+namespace gnomes {
+
+// Type for a rectangular grid of cells holding values of type Value, some of
+// which are rocks. (0, 0) may not be a rock; its value is never collected.
+template <typename Value>
+class weighted_grid {
+private:
+  coordinate rows_, columns_;
+  std::vector<Value> values_;
+  std::vector<bool> rocks_;
+
+  size_t index(coordinate row, coordinate column) const {
+    assert(row < rows_);
+    assert(column < columns_);
+    return row * columns_ + column;
+  }
+
+public:
+  using value_type = Value;
+
+  // Create a grid with the given number of rows and columns, all open and
+  // holding zero.
+  weighted_grid(coordinate rows, coordinate columns)
+  : rows_(rows),
+    columns_(columns),
+    values_(rows * columns, 0),
+    rocks_(rows * columns, false) {
+
+    assert(rows > 0);
+    assert(columns > 0);
+  }
+
+  // Accessors.
+  coordinate rows() const { return rows_; }
+  coordinate columns() const { return columns_; }
+  Value value(coordinate row, coordinate column) const { return values_[index(row, column)]; }
+  bool is_rock(coordinate row, coordinate column) const { return rocks_[index(row, column)]; }
+
+  // Set the value of the given cell and make it open.
+  void set_value(coordinate row, coordinate column, Value value) {
+    values_[index(row, column)] = value;
+    rocks_[index(row, column)] = false;
+  }
+
+  // Make the given cell, which must not be (0, 0), a rock.
+  void set_rock(coordinate row, coordinate column) {
+    assert(row != 0 || column != 0);
+    values_[index(row, column)] = 0;
+    rocks_[index(row, column)] = true;
+  }
+
+  // Return the largest absolute value of any cell.
+  uint64_t max_abs_value() const {
+    uint64_t result = 0;
+    for (Value v : values_) {
+      result = std::max(result, (v < 0) ? uint64_t(0) - uint64_t(v) : uint64_t(v));
+    }
+    return result;
+  }
+};
+
+// Convert an ordinary grid to a weighted grid in which each gold cell is worth
+// 1 and each earth cell 0.
+weighted_grid<uint8_t> weighted_from(const grid& setting) {
+  weighted_grid<uint8_t> result(setting.rows(), setting.columns());
+  for (coordinate i = 0; i < setting.rows(); ++i) {
+    for (coordinate j = 0; j < setting.columns(); ++j) {
+      switch (setting.get(i, j)) {
+      case CELL_GOLD:
+        result.set_value(i, j, 1);
+        break;
+      case CELL_ROCK:
+        result.set_rock(i, j);
+        break;
+      default:
+        break;
+      }
+    }
+  }
+  return result;
+}
+
+// Return true if signed type Score can hold the score of any path through at
+// most path_cells cells of absolute value at most max_abs_value, with room
+// left below for weighted_unreachable.
+template <typename Score>
+constexpr bool score_fits(uint64_t max_abs_value, uint64_t path_cells) {
+  return (max_abs_value == 0) ||
+         (path_cells <= uint64_t(std::numeric_limits<Score>::max() / 2) / max_abs_value);
+}
+
+// The narrowest of int8_t, int16_t, int32_t and int64_t that score_fits
+// allows for paths through at most MaxPathCells cells of absolute value at
+// most MaxAbsValue.
+template <uint64_t MaxAbsValue, uint64_t MaxPathCells>
+struct narrowest_score {
+  static_assert(score_fits<int64_t>(MaxAbsValue, MaxPathCells),
+                "scores may overflow int64_t");
+
+  using type =
+    typename std::conditional<score_fits<int8_t>(MaxAbsValue, MaxPathCells), int8_t,
+    typename std::conditional<score_fits<int16_t>(MaxAbsValue, MaxPathCells), int16_t,
+    typename std::conditional<score_fits<int32_t>(MaxAbsValue, MaxPathCells), int32_t,
+                              int64_t>::type>::type>::type;
+};
+
+// Score held for a cell no path can reach. Every real score is above it, and
+// far enough from the type's limits that adding a cell value cannot overflow.
+template <typename Score>
+constexpr Score weighted_unreachable() {
+  return std::numeric_limits<Score>::min() / 2;
+}
+
+// Return true if scores of type Score cannot overflow on the given grid.
+template <typename Score, typename Value>
+bool is_score_type_safe(const weighted_grid<Value>& setting) {
+  return score_fits<Score>(setting.max_abs_value(),
+                           setting.rows() + setting.columns() - 1);
+}
+
+// The result of a weighted score-only solve: the best score and the cell
+// where a path achieving it ends.
+template <typename Score>
+struct weighted_score {
+  Score total_value;
+  coordinate final_row, final_column;
+};
+
+// A path found by a weighted solver, with its moves packed one bit each as
+// path does (1 for right, 0 for down).
+template <typename Score>
+class weighted_path {
+private:
+  std::vector<row_word> moves_;
+  size_t length_;
+  coordinate final_row_, final_column_;
+  Score total_value_;
+
+public:
+
+  // Create the path ending at (final_row, final_column) that scores
+  // total_value, learning its moves from is_from_left as the path
+  // constructor of the same form does.
+  template <typename FromLeft>
+  weighted_path(coordinate final_row, coordinate final_column, Score total_value,
+                FromLeft is_from_left)
+  : moves_((final_row + final_column + CELLS_PER_WORD - 1) / CELLS_PER_WORD, 0),
+    length_(final_row + final_column),
+    final_row_(final_row),
+    final_column_(final_column),
+    total_value_(total_value) {
+
+    coordinate row = final_row, column = final_column;
+    for (size_t k = length_; k > 0; --k) {
+      if (is_from_left(row, column)) {
+        moves_[(k - 1) / CELLS_PER_WORD] |= row_word(1) << ((k - 1) % CELLS_PER_WORD);
+        --column;
+      } else {
+        --row;
+      }
+    }
+    assert(row == 0 && column == 0);
+  }
+
+  // Copy a path found with another score type. The step entering cell
+  // (i, j) is step i+j.
+  template <typename Other>
+  explicit weighted_path(const weighted_path<Other>& o)
+  : weighted_path(o.final_row(), o.final_column(), Score(o.total_value()),
+                  [&o](coordinate i, coordinate j) {
+                    return o.direction(i + j) == STEP_DIRECTION_RIGHT;
+                  }) { }
+
+  // Accessors.
+  coordinate final_row() const { return final_row_; }
+  coordinate final_column() const { return final_column_; }
+  Score total_value() const { return total_value_; }
+
+  // Return the number of steps, including the STEP_DIRECTION_START step.
+  size_t step_count() const { return length_ + 1; }
+
+  // Return the direction of step k, where step 0 is STEP_DIRECTION_START.
+  step_direction direction(size_t k) const {
+    assert(k < step_count());
+    if (k == 0) {
+      return STEP_DIRECTION_START;
+    } else if ((moves_[(k - 1) / CELLS_PER_WORD] >> ((k - 1) % CELLS_PER_WORD)) & 1) {
+      return STEP_DIRECTION_RIGHT;
+    } else {
+      return STEP_DIRECTION_DOWN;
+    }
+  }
+};
+
+// Solve the weighted problem for the given grid, adding scores up in type
+// Score, which must be safe for the grid as is_score_type_safe checks.
+//
+// This fills a row-major table of scores and predecessor bits and rebuilds
+// the path, as greedy_gnomes_dyn_prog does, with the same tie-breaking:
+// from above when both neighbors tie, and the first best cell in row-major
+// order. The empty path, scoring 0, is returned when every other path scores
+// less.
+template <typename Score, typename Value>
+weighted_path<Score> weighted_dyn_prog(const weighted_grid<Value>& setting) {
+  assert(is_score_type_safe<Score>(setting));
+
+  const coordinate r = setting.rows(),
+                   c = setting.columns();
+  const Score unreachable = weighted_unreachable<Score>();
+  std::vector<Score> scores(r * c, unreachable);
+  std::vector<bool> from_left(r * c, false);
+
+  coordinate best_row = 0, best_column = 0;
+  for (coordinate i = 0; i < r; ++i) {
+    for (coordinate j = 0; j < c; ++j) {
+      if (setting.is_rock(i, j)) {
+        continue;
+      }
+      const size_t k = i * c + j;
+      Score above = (i > 0) ? scores[k - c] : unreachable,
+            left = (j > 0) ? scores[k - 1] : unreachable;
+      if (i == 0 && j == 0) {
+        scores[k] = 0;
+        continue;
+      } else if (above == unreachable && left == unreachable) {
+        continue;
+      }
+      from_left[k] = (left > above);
+      scores[k] = Score(std::max(above, left) + Score(setting.value(i, j)));
+      if (scores[k] > scores[best_row * c + best_column]) {
+        best_row = i;
+        best_column = j;
+      }
+    }
+  }
+
+  return weighted_path<Score>(best_row, best_column, scores[best_row * c + best_column],
+                              [&](coordinate i, coordinate j) {
+                                return bool(from_left[i * c + j]);
+                              });
+}
+
+// Compute only the best score, and where a path achieving it ends, for the
+// given grid, adding scores up in type Score, which must be safe for the grid
+// as is_score_type_safe checks. The result agrees with weighted_dyn_prog.
+//
+// This sweeps one anti-diagonal at a time, as
+// greedy_gnomes_dyn_prog_score_wavefront does, in O(rows) memory. The inner
+// loop is written without branches over flat arrays of Score, so the
+// compiler can vectorize it, and the narrower Score is the more cells each
+// vector instruction covers.
+template <typename Score, typename Value>
+weighted_score<Score> weighted_dyn_prog_score(const weighted_grid<Value>& setting) {
+  assert(is_score_type_safe<Score>(setting));
+
+  const coordinate r = setting.rows(),
+                   c = setting.columns();
+  const Score unreachable = weighted_unreachable<Score>();
+
+  // Diagonal buffers are indexed by row + 1, so index 0 stands for the
+  // nonexistent row above row 0 and always stays unreachable.
+  std::vector<Score> previous(r + 2, unreachable),
+                     current(r + 2, unreachable),
+                     values(r), blocked(r);
+  previous[1] = 0;
+
+  weighted_score<Score> best = { 0, 0, 0 };
+  for (coordinate k = 1; k + 1 < r + c; ++k) {
+    const coordinate first = (k >= c) ? (k - c + 1) : 0,
+                     last = std::min(r - 1, k),
+                     count = last - first + 1;
+
+    for (coordinate i = first; i <= last; ++i) {
+      values[i - first] = Score(setting.value(i, k - i));
+      blocked[i - first] = setting.is_rock(i, k - i) ? 1 : 0;
+    }
+
+    current[first] = unreachable;
+    const Score* above = &previous[first];
+    Score* out = &current[first + 1];
+    for (coordinate t = 0; t < count; ++t) {
+      Score from = std::max(above[t], above[t + 1]);
+      out[t] = (blocked[t] | (from == unreachable)) ? unreachable : Score(from + values[t]);
+    }
+
+    for (coordinate i = first; i <= last; ++i) {
+      Score score = current[i + 1];
+      if (score != unreachable &&
+          (score > best.total_value ||
+           (score == best.total_value &&
+            (i < best.final_row ||
+             (i == best.final_row && k - i < best.final_column))))) {
+        best.total_value = score;
+        best.final_row = i;
+        best.final_column = k - i;
+      }
+    }
+
+    std::swap(previous, current);
+  }
+
+  return best;
+}
+
+// Widen a result to int64_t scores.
+template <typename Score>
+weighted_score<int64_t> widen(const weighted_score<Score>& score) {
+  return weighted_score<int64_t>{ score.total_value, score.final_row, score.final_column };
+}
+
+template <typename Score>
+weighted_path<int64_t> widen(const weighted_path<Score>& p) {
+  return weighted_path<int64_t>(p);
+}
+
+// Run weighted_dyn_prog with the narrowest score type that is safe for the
+// given grid, and return the result widened to int64_t.
+template <typename Value>
+weighted_path<int64_t> weighted_dyn_prog_auto(const weighted_grid<Value>& setting) {
+  if (is_score_type_safe<int8_t>(setting)) {
+    return widen(weighted_dyn_prog<int8_t>(setting));
+  } else if (is_score_type_safe<int16_t>(setting)) {
+    return widen(weighted_dyn_prog<int16_t>(setting));
+  } else if (is_score_type_safe<int32_t>(setting)) {
+    return widen(weighted_dyn_prog<int32_t>(setting));
+  } else {
+    return weighted_dyn_prog<int64_t>(setting);
+  }
+}
+
+// Run weighted_dyn_prog_score with the narrowest score type that is safe for
+// the given grid, and return the result widened to int64_t.
+template <typename Value>
+weighted_score<int64_t> weighted_dyn_prog_score_auto(const weighted_grid<Value>& setting) {
+  if (is_score_type_safe<int8_t>(setting)) {
+    return widen(weighted_dyn_prog_score<int8_t>(setting));
+  } else if (is_score_type_safe<int16_t>(setting)) {
+    return widen(weighted_dyn_prog_score<int16_t>(setting));
+  } else if (is_score_type_safe<int32_t>(setting)) {
+    return widen(weighted_dyn_prog_score<int32_t>(setting));
+  } else {
+    return weighted_dyn_prog_score<int64_t>(setting);
+  }
+}
+
+}
@@ -0,0 +1,181 @@
+///////////////////////////////////////////////////////////////////////////////
+// thread_pool.hpp
+//
+// Work-stealing thread pool.
+//
+// This class depends only on the C++11 STL. Each worker owns a double-ended
+// queue of tasks; it runs its own tasks newest-first, and when its queue is
+// empty it steals the oldest task from another worker. Tasks submitted from
+// inside a task go to the current worker's queue, so a task may spawn more
+// work without any central bottleneck.
+//
+// How to use:
+//
+//    ThreadPool pool(4);
+//    for (size_t i = 0; i < n; ++i) {
+//      pool.submit([i]() { ... });
+//    }
+//    pool.wait();
+//
+// Tasks must not throw, and wait() must not be called from inside a task.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+class ThreadPool {
+private:
+  struct Queue {
+    std::mutex lock;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  std::vector<std::unique_ptr<Queue>> _queues;
+  std::vector<std::thread> _workers;
+
+  // _lock guards the counters below. _queued counts tasks sitting in queues
+  // that no worker has claimed yet; _pending counts tasks not yet finished.
+  std::mutex _lock;
+  std::condition_variable _wake, _idle;
+  size_t _queued, _pending, _next;
+  bool _stopping;
+
+  // The pool and worker index of the calling thread, if it is a worker.
+  static std::pair<const ThreadPool*, size_t>& current() {
+    thread_local std::pair<const ThreadPool*, size_t> worker(nullptr, 0);
+    return worker;
+  }
+
+  // Pop a task from worker self's own queue, or else steal one from another
+  // worker's queue. Returns false if every queue is empty.
+  bool take(size_t self, std::function<void()>& task) {
+    for (size_t k = 0; k < _queues.size(); ++k) {
+      auto& queue = *_queues[(self + k) % _queues.size()];
+      std::lock_guard<std::mutex> guard(queue.lock);
+      if (!queue.tasks.empty()) {
+        if (k == 0) {
+          task = std::move(queue.tasks.back());
+          queue.tasks.pop_back();
+        } else {
+          task = std::move(queue.tasks.front());
+          queue.tasks.pop_front();
+        }
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Main loop of worker self.
+  void run(size_t self) {
+    current() = std::make_pair(this, self);
+    for (;;) {
+      {
+        // Claim one queued task before looking for it, so the number of
+        // claims never exceeds the number of tasks in the queues.
+        std::unique_lock<std::mutex> guard(_lock);
+        _wake.wait(guard, [this]() { return _stopping || (_queued > 0); });
+        if (_queued == 0) {
+          return;
+        }
+        --_queued;
+      }
+
+      std::function<void()> task;
+      while (!take(self, task)) {
+        std::this_thread::yield();
+      }
+      task();
+
+      std::lock_guard<std::mutex> guard(_lock);
+      if (--_pending == 0) {
+        _idle.notify_all();
+      }
+    }
+  }
+
+public:
+
+  // Start a pool with the given number of worker threads; zero means one per
+  // hardware thread.
+  explicit ThreadPool(size_t threads = 0)
+  : _queued(0), _pending(0), _next(0), _stopping(false) {
+    if (threads == 0) {
+      threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (size_t i = 0; i < threads; ++i) {
+      _queues.emplace_back(new Queue());
+    }
+    for (size_t i = 0; i < threads; ++i) {
+      _workers.emplace_back(&ThreadPool::run, this, i);
+    }
+  }
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  // Finish every submitted task, then stop the workers.
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> guard(_lock);
+      _stopping = true;
+    }
+    _wake.notify_all();
+    for (auto& worker : _workers) {
+      worker.join();
+    }
+  }
+
+  // Accessor.
+  size_t size() const { return _workers.size(); }
+
+  // Return the index of the calling thread among this pool's workers, in
+  // [0, size()), or size() if it is not one of them. Tasks can use it to pick
+  // per-worker scratch space.
+  size_t worker_index() const {
+    auto& worker = current();
+    return (worker.first == this) ? worker.second : size();
+  }
+
+  // Queue a task to run on some worker.
+  void submit(std::function<void()> task) {
+    size_t target;
+    auto& worker = current();
+    if (worker.first == this) {
+      target = worker.second;
+    } else {
+      std::lock_guard<std::mutex> guard(_lock);
+      target = _next++ % _queues.size();
+    }
+
+    {
+      std::lock_guard<std::mutex> guard(_queues[target]->lock);
+      _queues[target]->tasks.push_back(std::move(task));
+    }
+    {
+      std::lock_guard<std::mutex> guard(_lock);
+      ++_queued;
+      ++_pending;
+    }
+    _wake.notify_one();
+  }
+
+  // Block until every submitted task, including tasks submitted by other
+  // tasks, has finished.
+  void wait() {
+    assert(current().first != this);
+    std::unique_lock<std::mutex> guard(_lock);
+    _idle.wait(guard, [this]() { return _pending == 0; });
+  }
+};
@@ -22,6 +22,7 @@
 
 #include <cassert>
 #include <chrono>
+#include <ctime>
 
 class Timer {
 private:
@@ -48,3 +49,28 @@ public:
     return time_span.count();
   }
 };
+
+// Like Timer, but measures processor time used by the whole program, summed
+// over all its threads, rather than wall-clock time.
+class CpuTimer {
+private:
+  std::clock_t _start;
+
+public:
+
+  // Create a new CpuTimer that is running as soon as it is created.
+  CpuTimer() {
+    reset();
+  }
+
+  // Reset the timer.
+  void reset() {
+    _start = std::clock();
+  }
+
+  // Return the number of processor seconds used since the timer was created,
+  // or the last time it was reset.
+  double elapsed() const {
+    return double(std::clock() - _start) / CLOCKS_PER_SEC;
+  }
+};